@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+#
+# bench.py - Throughput benchmark for the cache simulator. Generates
+#     synthetic traces of a configurable size and access pattern, runs
+#     ./csim over a matrix of cache geometries (s, E, b) and policies,
+#     and reports accesses per second, ns per access and peak RSS for
+#     each run. Results are written as CSV or JSON so runs from different
+#     revisions can be compared with --compare.
+#
+import json
+import optparse
+import os
+import re
+import subprocess
+import sys
+
+# Access patterns understood by genTrace
+PATTERNS = ["seq", "stride", "random", "transpose"]
+
+# Replacement/extension policies: name -> extra csim arguments
+POLICIES = {
+    "lru": [],
+    "next": ["-p", "next"],
+    "stride": ["-p", "stride"],
+    "stream": ["-p", "stream"],
+    "tlb": ["-T", "64:4,1536:12"],
+    "victim": ["-V", "victim:4"],
+    "misscache": ["-V", "miss:4"],
+}
+
+# Columns of a result row, in output order
+FIELDS = ["pattern", "format", "accesses", "s", "E", "b", "policy", "seconds",
+          "accesses_per_sec", "ns_per_access", "peak_rss_kb",
+          "hits", "misses", "evictions"]
+
+#
+# genTrace - write a trace of n accesses to path with tracesynth
+#
+def genTrace(tracesynth, path, pattern, n, seed, footprint, stride, binary):
+    if pattern == "seq":
+        model = ["-m", "stride", "-S", "4", "-F", str(footprint)]
+    elif pattern == "stride":
+        model = ["-m", "stride", "-S", str(stride), "-F", str(footprint)]
+    elif pattern == "random":
+        # a Zipf skew of 0 is uniform over the footprint's words
+        model = ["-m", "zipf", "-z", "0", "-S", "4", "-K",
+                 str(footprint // 4), "-w", "0.3"]
+    elif pattern == "transpose":
+        # B = A^T over square int matrices sized to the footprint
+        dim = max(1, int((footprint // 8) ** 0.5))
+        model = ["-m", "transpose", "-N", str(dim)]
+    else:
+        raise ValueError("unknown pattern %s" % pattern)
+    args = [tracesynth, "-n", str(n), "-r", str(seed), "-o", path] + model
+    if binary:
+        args.append("-B")
+    subprocess.check_call(args)
+
+#
+# runCsim - run csim once under benchrun, returning
+#     (seconds, peak RSS in KB, summary)
+#
+def runCsim(benchrun, csim, trace, s, E, b, extra):
+    # -n: leave the .csim_results of the last graded run alone
+    args = [benchrun, csim, "-s", str(s), "-E", str(E), "-b", str(b),
+            "-t", trace, "-n"] + extra
+    p = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    stdout_data, stderr_data = p.communicate()
+    if p.returncode != 0:
+        raise RuntimeError("%s failed with status %d:\n%s" %
+                           (" ".join(args), p.returncode, stderr_data.decode()))
+    result = re.findall(r"BENCHRUN_RESULTS=(\d+):(\d+)", stderr_data.decode())
+    ns, rss = map(int, result[-1])
+    summary = {}
+    for line in stdout_data.decode().splitlines():
+        if line.startswith("hits:"):
+            for field in line.split():
+                key, value = field.split(":")
+                summary[key] = int(value)
+    return ns / 1e9, rss, summary
+
+def parseConfigs(text):
+    configs = []
+    for item in text.split(","):
+        s, E, b = item.split(":")
+        configs.append((int(s), int(E), int(b)))
+    return configs
+
+def writeResults(rows, fmt, out):
+    if fmt == "json":
+        json.dump(rows, out, indent=1)
+        out.write("\n")
+    else:
+        out.write(",".join(FIELDS) + "\n")
+        for row in rows:
+            out.write(",".join(str(row[f]) for f in FIELDS) + "\n")
+
+def readResults(path):
+    f = open(path)
+    text = f.read()
+    f.close()
+    if text.lstrip().startswith("["):
+        return json.loads(text)
+    lines = text.splitlines()
+    header = lines[0].split(",")
+    return [dict(zip(header, line.split(","))) for line in lines[1:] if line]
+
+def rowKey(row):
+    return tuple(str(row[f]) for f in ["pattern", "format", "accesses", "s", "E", "b", "policy"])
+
+#
+# compare - print the change in ns/access against an earlier result file
+#
+def compare(rows, path):
+    old = dict((rowKey(r), r) for r in readResults(path))
+    print("%-10s %10s %-10s %-8s %10s %10s %8s" %
+          ("pattern", "accesses", "s:E:b", "policy", "old ns", "new ns", "change"),
+          file=sys.stderr)
+    for row in rows:
+        prev = old.get(rowKey(row))
+        if prev is None:
+            continue
+        before = float(prev["ns_per_access"])
+        after = float(row["ns_per_access"])
+        print("%-10s %10s %-10s %-8s %10.2f %10.2f %+7.1f%%" %
+              (row["pattern"], row["accesses"],
+               "%s:%s:%s" % (row["s"], row["E"], row["b"]), row["policy"],
+               before, after, (after - before) / before * 100.0),
+              file=sys.stderr)
+
+#
+# main - Main function
+#
+def main():
+    p = optparse.OptionParser(usage="%prog [options]")
+    p.add_option("-n", dest="accesses", type="int", default=1000000,
+                 help="accesses per synthetic trace [%default]")
+    p.add_option("-p", dest="patterns", default=",".join(PATTERNS),
+                 help="comma separated patterns from %s [%%default]" %
+                 "/".join(PATTERNS))
+    p.add_option("-c", dest="configs", default="5:1:5,8:4:6,12:8:6,16:4:6",
+                 help="comma separated s:E:b geometries [%default]")
+    p.add_option("-P", dest="policies", default="lru",
+                 help="comma separated policies from %s [%%default]" %
+                 "/".join(sorted(POLICIES)))
+    p.add_option("-F", dest="footprint", type="int", default=64 << 20,
+                 help="bytes touched by the synthetic traces [%default]")
+    p.add_option("-S", dest="stride", type="int", default=4160,
+                 help="byte stride of the stride pattern [%default]")
+    p.add_option("-r", dest="repeat", type="int", default=3,
+                 help="runs per point; the fastest is reported [%default]")
+    p.add_option("--seed", dest="seed", type="int", default=341,
+                 help="random seed for trace generation [%default]")
+    p.add_option("-d", dest="tracedir", default=".bench-traces",
+                 help="directory caching generated traces [%default]")
+    p.add_option("-f", dest="format", default="csv",
+                 help="output format, csv or json [%default]")
+    p.add_option("-o", dest="output", help="write results to this file")
+    p.add_option("--compare", dest="compare",
+                 help="print the ns/access change against an earlier result file")
+    p.add_option("-B", dest="binary", action="store_true", default=False,
+                 help="use binary instead of text traces")
+    p.add_option("--tracesynth", dest="tracesynth", default="./tracesynth",
+                 help="trace generator binary [%default]")
+    p.add_option("--csim", dest="csim", default="./csim",
+                 help="simulator binary [%default]")
+    p.add_option("--benchrun", dest="benchrun", default="./benchrun",
+                 help="timing wrapper binary [%default]")
+    opts, args = p.parse_args()
+
+    if opts.format not in ("csv", "json"):
+        p.error("format must be csv or json")
+    policies = opts.policies.split(",")
+    for policy in policies:
+        if policy not in POLICIES:
+            p.error("unknown policy %s" % policy)
+
+    if not os.path.isdir(opts.tracedir):
+        os.makedirs(opts.tracedir)
+
+    rows = []
+    for pattern in opts.patterns.split(","):
+        if pattern not in PATTERNS:
+            p.error("unknown pattern %s" % pattern)
+        trace = os.path.join(opts.tracedir, "%s-%d-%d-%d-%d.%s" %
+                             (pattern, opts.accesses, opts.footprint,
+                              opts.stride, opts.seed,
+                              "bin" if opts.binary else "trace"))
+        if not os.path.exists(trace):
+            print("Generating %s" % trace, file=sys.stderr)
+            genTrace(opts.tracesynth, trace + ".tmp", pattern, opts.accesses,
+                     opts.seed, opts.footprint, opts.stride, opts.binary)
+            os.rename(trace + ".tmp", trace)
+
+        for s, E, b in parseConfigs(opts.configs):
+            for policy in policies:
+                best = None
+                for _ in range(opts.repeat):
+                    run = runCsim(opts.benchrun, opts.csim, trace, s, E, b, POLICIES[policy])
+                    if best is None or run[0] < best[0]:
+                        best = run
+                elapsed, rss, summary = best
+                row = {
+                    "pattern": pattern,
+                    "format": "bin" if opts.binary else "text",
+                    "accesses": opts.accesses,
+                    "s": s, "E": E, "b": b, "policy": policy,
+                    "seconds": round(elapsed, 6),
+                    "accesses_per_sec": int(opts.accesses / elapsed),
+                    "ns_per_access": round(elapsed * 1e9 / opts.accesses, 2),
+                    "peak_rss_kb": rss,
+                    "hits": summary.get("hits", -1),
+                    "misses": summary.get("misses", -1),
+                    "evictions": summary.get("evictions", -1),
+                }
+                rows.append(row)
+                print("%-10s s=%-2d E=%-2d b=%-2d %-8s %8.2f ns/access %7d KB" %
+                      (pattern, s, E, b, policy, row["ns_per_access"], rss),
+                      file=sys.stderr)
+
+    if opts.output:
+        out = open(opts.output, "w")
+        writeResults(rows, opts.format, out)
+        out.close()
+    else:
+        writeResults(rows, opts.format, sys.stdout)
+
+    if opts.compare:
+        compare(rows, opts.compare)
+
+# execute main only if called as a script
+if __name__ == "__main__":
+    main()
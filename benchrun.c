@@ -0,0 +1,54 @@
+/*
+ * benchrun.c - Run a command and report its wall-clock time and peak
+ *     resident set size. Used by bench.py: the peak RSS of a process
+ *     forked directly from the Python interpreter includes the
+ *     interpreter's own footprint, so the command is forked from this
+ *     small process instead.
+ *
+ * Usage: benchrun <command> [args...]
+ * Prints BENCHRUN_RESULTS=<nanoseconds>:<peak rss kb> to stderr and
+ * exits with the command's exit status.
+ */
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+int main(int argc, char* argv[])
+{
+    struct timespec start, end;
+    struct rusage usage;
+    int status;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <command> [args...]\n", argv[0]);
+        exit(1);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        execvp(argv[1], argv + 1);
+        perror(argv[1]);
+        _exit(127);
+    }
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("wait4");
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long long ns = (end.tv_sec - start.tv_sec) * 1000000000LL +
+        (end.tv_nsec - start.tv_nsec);
+    fprintf(stderr, "BENCHRUN_RESULTS=%lld:%ld\n", ns, usage.ru_maxrss);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
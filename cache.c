@@ -0,0 +1,138 @@
+/*
+ * cache.c - Set/line model shared by the cache simulator modes
+ */
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+static long foldChunks(long value, int s);
+
+void initializeCache(Line_t sets[], long set_count, int E) {
+    for (long set = 0; set < set_count; set++) {
+        for (int lineOffset = 0; lineOffset < E; lineOffset++) {
+            sets[set * E + lineOffset].valid = 0;
+            sets[set * E + lineOffset].state = STATE_I;
+            sets[set * E + lineOffset].prefetched = 0;
+            sets[set * E + lineOffset].tag = -1;
+            sets[set * E + lineOffset].last_used = -1;
+        }
+    }
+}
+
+void* allocateArray(long count, long per, size_t size) {
+    if (count < 0 || per < 0 ||
+            (per && (size_t) count > SIZE_MAX / size / (size_t) per)) {
+        return NULL;
+    }
+    return malloc((size_t) count * per * size);
+}
+
+Line_t* allocateCache(int s, int E) {
+    if (s < 0 || s >= 63) {
+        return NULL;
+    }
+    Line_t* sets = allocateArray(1L << s, E, sizeof(Line_t));
+    if (sets != NULL) {
+        initializeCache(sets, 1L << s, E);
+    }
+    return sets;
+}
+
+int findLine(Line_t set[], int E, long tag) {
+    for (int line = 0; line < E; line++) {
+        if (set[line].valid && set[line].tag == tag) {
+            return line;
+        }
+    }
+    return -1;
+}
+
+int victimLine(Line_t set[], int E) {
+    int leastRecentIndex = 0;
+    long oldestTime = LONG_MAX;
+    for (int line = 0; line < E; line++) {
+        if (!set[line].valid) {
+            return line;
+        }
+        if (set[line].last_used < oldestTime) {
+            oldestTime = set[line].last_used;
+            leastRecentIndex = line;
+        }
+    }
+    return leastRecentIndex;
+}
+
+int setIndexInit(SetIndex_t* ix, const char* name, int s) {
+    ix->s = s;
+    ix->sets = 1L << s;
+    if (strcmp(name, "bits") == 0) {
+        ix->hash = HASH_BITS;
+    } else if (strcmp(name, "xor") == 0) {
+        ix->hash = HASH_XOR;
+    } else if (strcmp(name, "prime") == 0) {
+        ix->hash = HASH_PRIME;
+        // largest prime not above 2^s, by trial division
+        for (long p = ix->sets; p > 1; p--) {
+            int prime = 1;
+            for (long d = 2; d * d <= p; d++) {
+                if (p % d == 0) {
+                    prime = 0;
+                    break;
+                }
+            }
+            if (prime) {
+                ix->sets = p;
+                break;
+            }
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+void blockToSet(const SetIndex_t* ix, long block, long* set, long* tag) {
+    switch (ix->hash)
+    {
+    case HASH_XOR:
+        *set = foldChunks(block, ix->s);
+        *tag = block >> ix->s;
+        break;
+    case HASH_PRIME:
+        *set = block % ix->sets;
+        *tag = block / ix->sets;
+        break;
+    default:
+        *set = block & (ix->sets - 1);
+        *tag = block >> ix->s;
+        break;
+    }
+}
+
+long setToBlock(const SetIndex_t* ix, long set, long tag) {
+    switch (ix->hash)
+    {
+    case HASH_XOR:
+        // the low chunk is the set with the tag's chunks folded back out
+        return (tag << ix->s) | (set ^ foldChunks(tag, ix->s));
+    case HASH_PRIME:
+        return tag * ix->sets + set;
+    default:
+        return (tag << ix->s) | set;
+    }
+}
+
+/* XOR of the s-bit chunks of a non-negative value */
+static long foldChunks(long value, int s) {
+    if (s == 0) {
+        return 0;
+    }
+    long mask = (1L << s) - 1;
+    long folded = 0;
+    for (; value; value = (unsigned long)value >> s) {
+        folded ^= value & mask;
+    }
+    return folded;
+}
@@ -0,0 +1,78 @@
+/*
+ * cache.h - Set/line model shared by the cache simulator modes
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+
+/* Coherence states of a line, only used in multi-core mode */
+enum LineState {
+    STATE_I,
+    STATE_S,
+    STATE_E,
+    STATE_O,
+    STATE_M
+};
+
+/* define Line struct and typedef */
+struct Line {
+    int valid;
+    unsigned char state;        /* enum LineState, multi-core mode only */
+    unsigned char prefetched;   /* filled by a prefetch, not yet used */
+    long tag;
+    long last_used;
+};
+typedef struct Line Line_t;
+
+/*
+ * How a block number selects its set. The default takes the low s bits;
+ * xor folds every s-bit chunk of the block number together, and prime
+ * takes the block number modulo the largest prime below 2^s, leaving
+ * the sets above it unused. The tag is whatever, together with the set,
+ * identifies the block again.
+ */
+enum SetHash {
+    HASH_BITS,
+    HASH_XOR,
+    HASH_PRIME
+};
+
+struct SetIndex {
+    enum SetHash hash;
+    int s;
+    long sets;      /* sets in use */
+};
+typedef struct SetIndex SetIndex_t;
+
+/* Set up an index for 2^s sets from a hash name: bits, xor or prime.
+   Returns -1 for an unknown name. */
+int setIndexInit(SetIndex_t* ix, const char* name, int s);
+
+/* Split a block number into set and tag, and join them again */
+void blockToSet(const SetIndex_t* ix, long block, long* set, long* tag);
+long setToBlock(const SetIndex_t* ix, long set, long tag);
+
+/* Mark every line of a set_count x E cache invalid */
+void initializeCache(Line_t sets[], long set_count, int E);
+
+/*
+ * allocateArray - malloc an array of count x per elements of size
+ *     bytes. Returns NULL when the size overflows or malloc fails.
+ */
+void* allocateArray(long count, long per, size_t size);
+
+/*
+ * allocateCache - Allocate and invalidate a cache of 2^s sets of E
+ *     lines. Returns NULL when it does not fit in memory.
+ */
+Line_t* allocateCache(int s, int E);
+
+/* Index of the valid line of a set holding tag, or -1 */
+int findLine(Line_t set[], int E, long tag);
+
+/* Index of the line to fill in a set: the first invalid line, else LRU */
+int victimLine(Line_t set[], int E);
+
+#endif /* CACHE_H */
@@ -16,6 +16,25 @@ typedef struct trans_func{
   unsigned int num_evictions;
 } trans_func_t;
 
+/* Largest element size, in bytes, of the sized transposes */
+#define MAX_ELEM_SIZE 16
+
+/* 
+ * A sized transpose works on elements of elem_size bytes (1, 2, 4, 8 or
+ * 16). A has N rows of M elements and B gets M rows of N; an in-place
+ * transpose is called with B == A and leaves the result in A.
+ */
+typedef struct sized_trans_func{
+  void (*func_ptr)(int M,int N,const void* A,void* B);
+  char* description;
+  int elem_size;
+  char in_place;
+  char correct;
+  unsigned int num_hits;
+  unsigned int num_misses;
+  unsigned int num_evictions;
+} sized_trans_func_t;
+
 /* 
  * printSummary - This function provides a standard way for your cache
  * simulator * to display its final hit and miss statistics
@@ -24,6 +43,21 @@ void printSummary(int hits,  /* number of  hits */
 				  int misses, /* number of misses */
 				  int evictions); /* number of evictions */
 
+/*
+ * printLongSummary - printSummary for counts past INT_MAX, as traces
+ * of billions of accesses produce
+ */
+void printLongSummary(long hits, long misses, long evictions);
+
+/*
+ * setResultsFile - Choose the file printSummary saves the counts to for
+ * the autograder, ".csim_results" by default, or NULL to skip it
+ */
+void setResultsFile(const char* path);
+
+/* saveResults - Save the counts to the results file, if there is one */
+void saveResults(long hits, long misses, long evictions);
+
 /* Fill the matrix with data */
 void initMatrix(int M, int N, int A[N][M], int B[M][N]);
 
@@ -34,4 +68,15 @@ void correctTrans(int M, int N, int A[N][M], int B[M][N]);
 void registerTransFunction(
     void (*trans)(int M,int N,int[N][M],int[M][N]), char* desc);
 
+/* Fill a matrix of N rows of M size-byte elements with random data */
+void initSizedMatrix(int M, int N, int size, void* A);
+
+/* The baseline sized transpose, A and B must not overlap */
+void correctSizedTrans(int M, int N, int size, const void* A, void* B);
+
+/* Add the given sized function to the sized function list */
+void registerSizedTransFunction(
+    void (*trans)(int M,int N,const void* A,void* B), int size,
+    int in_place, char* desc);
+
 #endif /* CACHELAB_TOOLS_H */
@@ -10,34 +10,90 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
-#include <math.h>
 #include <string.h>
 #include <limits.h>
 #include "cachelab.h"
+#include "traceio.h"
+#include "cache.h"
+#include "mesi.h"
+#include "prefetch.h"
+#include "tlb.h"
+#include "victim.h"
+#include "reuse.h"
 
 /* define line max length */
 #define MAX_LENGTH 255
+/* number of trace accesses decoded and resolved together */
+#define BATCH_SIZE 64
+/* stdout buffer for verbose runs, so events leave in large writes */
+#define OUTPUT_BUFFER (1 << 20)
 
-/* define Line struct and typedef */
-struct Line {
-    int valid;
+/* outcome of one cache lookup */
+enum Result {
+    RESULT_HIT,
+    RESULT_MISS,
+    RESULT_MISS_EVICTION,
+    RESULT_HIT_EVICTION     // supplied by a stream buffer or victim cache
+};
+const char* resultNames[] = {"hit", "miss", "miss eviction", "hit eviction"};
+
+/* -o output formats */
+enum Format {
+    FORMAT_TEXT,
+    FORMAT_JSON,
+    FORMAT_BIN
+};
+
+/*
+ * -o bin events start with the magic string and continue with one
+ * little-endian 64-bit word per access, packed like a binary trace
+ * record (traceio.h) with the thread bits holding the results:
+ *   bits  0-47  address
+ *   bits 48-55  access size in bytes
+ *   bits 56-59  operation (TRACE_OP_*)
+ *   bits 60-61  result (enum Result), of the load for a modify
+ *   bits 62-63  result of the store of a modify
+ */
+#define EVENT_BIN_MAGIC "CSIMEVT1"
+#define EVENT_PACK(op, size, first, second, addr) \
+    (TRACE_PACK(op, size, 0, addr) | \
+     ((unsigned long long) (first) << 60) | \
+     ((unsigned long long) (second) << 62))
+
+/* define Access struct: one decoded trace access in a batch */
+struct Access {
+    char instruction;
+    unsigned long address;
+    unsigned char size;
+    long set;
     long tag;
-    long last_used;
+    char line[MAX_LENGTH];  // trace text, only filled in verbose mode
 };
-typedef struct Line Line_t;
+typedef struct Access Access_t;
 
 /* Function prototypes */
-char* loadOrSaveData(Line_t cacheSets[], long tag, long set, int E,
-         int* hit_count_p, int* miss_count_p, int* eviction_count_p);
+int decodeBatch(TraceReader_t* traceFile, Access_t batch[], int text);
+void indexBatch(Access_t batch[], int count, Line_t cacheSets[], int E,
+         const SetIndex_t* index, int b);
+void resolveBatch(Access_t batch[], int count, Line_t cacheSets[], int E,
+         int v, enum Format format, Prefetcher_t* pf, Victim_t* vc,
+         long* hit_count_p, long* miss_count_p, long* eviction_count_p);
+void printEvent(Access_t* access, int first, int second, enum Format format);
+void printJsonSummary(FILE* out, long hits, long misses, long evictions,
+         Prefetcher_t* pf, Tlb_t* tlb, Victim_t* vc);
+int loadOrSaveData(Line_t cacheSets[], long tag, long set, int E,
+         Prefetcher_t* pf, Victim_t* vc,
+         long* hit_count_p, long* miss_count_p, long* eviction_count_p);
 void evict(Line_t cacheSets[], long tag, long set, int E, int line);
 // void decrementUnused(Line_t cacheSets[], long set, int E, int usedIndex);
-void initializeCache(Line_t sets[], int set_count, int E);
-long extract(int num, int length, int offset);
+int simulateMultiCore(char* traces[], int trace_count, int cores,
+         int quantum, int moesi, int s, int E, int b, int v);
+int analyzeReuse(char* trace, int b, long window, char* prefix);
 void printHelp();
 void printError(char* msg);
 void printSet(Line_t cacheSets[], int E, int set);
 // traceLine used to keep track of oldest lines in a set
-int traceLine = 0;
+long traceLine = 0;
 
 // Main application run
 int main(int argc, char *argv[]) {
@@ -52,12 +108,36 @@ int main(int argc, char *argv[]) {
     int E = -1;
     // -b <b> number of block bits (B = 2^b)
     int b = -1;
-    // -t <tracefile> name of trace file to replay
+    // -t <tracefile> name of trace file to replay, repeated for one
+    // trace per core in multi-core mode
     char* trace = NULL;
+    char* traces[MAX_CORES];
+    int trace_count = 0;
+    // -c <cores> number of cores sharing a tagged trace
+    int cores = 0;
+    // -P <protocol> coherence protocol, mesi or moesi
+    int moesi = 0;
+    // -q <quantum> accesses per core turn when interleaving traces
+    int quantum = 1;
+    // -p <model> optional hardware prefetcher
+    char* prefetch = NULL;
+    // -T <levels> optional TLB, -g <page> its page size
+    char* tlbSpec = NULL;
+    char* page = "4K";
+    // -V <buffer> optional victim or miss cache
+    char* victim = NULL;
+    // -H <hash> set index function: bits, xor or prime
+    char* hash = "bits";
+    // -R <prefix> reuse distance and working set analysis instead of
+    // simulation, -w <window> accesses per working set window
+    char* reuse = NULL;
+    long window = 10000;
+    // -o <format> text, json or bin output, -n skip .csim_results
+    enum Format format = FORMAT_TEXT;
 
     // Parse arguments
     int opt;
-    while ((opt = getopt(argc, argv, "hvs:E:b:t:")) != -1) {
+    while ((opt = getopt(argc, argv, "hvs:E:b:t:c:P:q:p:T:g:V:H:R:w:o:n")) != -1) {
         switch (opt)
         {
         case 'h':
@@ -76,7 +156,64 @@ int main(int argc, char *argv[]) {
             b = atoi(optarg);
             break;
         case 't':
+            if (trace_count == MAX_CORES) {
+                printError("Too many trace files");
+                return 1;
+            }
             trace = optarg;
+            traces[trace_count++] = optarg;
+            break;
+        case 'c':
+            cores = atoi(optarg);
+            break;
+        case 'P':
+            if (strcmp(optarg, "mesi") == 0) {
+                moesi = 0;
+            } else if (strcmp(optarg, "moesi") == 0) {
+                moesi = 1;
+            } else {
+                printError("Protocol must be mesi or moesi. -P <protocol>");
+                return 1;
+            }
+            break;
+        case 'q':
+            quantum = atoi(optarg);
+            break;
+        case 'p':
+            prefetch = optarg;
+            break;
+        case 'T':
+            tlbSpec = optarg;
+            break;
+        case 'g':
+            page = optarg;
+            break;
+        case 'V':
+            victim = optarg;
+            break;
+        case 'H':
+            hash = optarg;
+            break;
+        case 'R':
+            reuse = optarg;
+            break;
+        case 'w':
+            window = atol(optarg);
+            break;
+        case 'o':
+            if (strcmp(optarg, "text") == 0) {
+                format = FORMAT_TEXT;
+            } else if (strcmp(optarg, "json") == 0) {
+                format = FORMAT_JSON;
+            } else if (strcmp(optarg, "bin") == 0) {
+                format = FORMAT_BIN;
+            } else {
+                printError("Output format must be text, json or bin. -o <format>");
+                return 1;
+            }
+            break;
+        case 'n':
+            setResultsFile(NULL);
             break;
         }
     }
@@ -87,6 +224,19 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    // The analysis is independent of the cache shape, so only needs -b
+    if (reuse) {
+        if (b < 0 || b >= 64 || trace == NULL || window < 1) {
+            printError("Reuse analysis needs -b, -t and a window of at least 1. -R <prefix>");
+            return 1;
+        }
+        if (trace_count > 1 || cores > 1) {
+            printError("Reuse analysis is not supported in multi-core mode");
+            return 1;
+        }
+        return analyzeReuse(trace, b, window, reuse);
+    }
+
     // Check all required arguments set
     if (s == -1) {
         printError("s is a required argument that must be set. -s <s>");
@@ -104,103 +254,302 @@ int main(int argc, char *argv[]) {
         printError("trace file is required argument that must be set. -t <trace>");
         return 1;
     }
+    // addresses are at most 48 bits, the width binary traces carry
+    if (s < 0 || b < 0 || E < 1 || s + b > 48) {
+        printError("s and b must be non-negative with s + b <= 48, and E at least 1");
+        return 1;
+    }
+    if (format == FORMAT_BIN && !v) {
+        printError("Binary output is an event stream and needs -v");
+        return 1;
+    }
     // End Argument parsing
 
-    // Initialize data structures
-    int set_count = pow(2, s);
-    Line_t cacheSets[set_count * E];
-    initializeCache(cacheSets, set_count, E);
+    // Verbose runs into a file or pipe are dominated by output, so
+    // buffer it in large blocks
+    if (v && !isatty(STDOUT_FILENO)) {
+        setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER);
+    }
+
+    // Several traces, or a trace tagged for several cores, simulate
+    // private coherent caches
+    if (trace_count > 1 || cores > 1) {
+        if (cores == 0) {
+            cores = trace_count;
+        }
+        if ((trace_count > 1 && cores != trace_count) || cores > MAX_CORES
+                || quantum < 1) {
+            printError("-c must match the number of traces, at most 16, and -q be at least 1");
+            return 1;
+        }
+        if (prefetch || tlbSpec || victim || strcmp(hash, "bits") != 0) {
+            printError("Prefetchers, TLBs, victim caches and set hashing are not supported in multi-core mode");
+            return 1;
+        }
+        if (format != FORMAT_TEXT) {
+            printError("JSON and binary output are not supported in multi-core mode");
+            return 1;
+        }
+        return simulateMultiCore(traces, trace_count, cores, quantum, moesi,
+                s, E, b, v);
+    }
+
+    // prefetch fills evict lines behind the victim cache's back, which
+    // would leave its conflict shadow stale
+    if (prefetch && victim) {
+        printError("Prefetchers and victim caches cannot be combined");
+        return 1;
+    }
+
+    SetIndex_t index;
+    if (setIndexInit(&index, hash, s)) {
+        printError("Set hash must be bits, xor or prime. -H <hash>");
+        return 1;
+    }
+
+    // Initialize data structures. The cache lives on the heap so large
+    // -s configurations do not overflow the stack.
+    Line_t* cacheSets = allocateCache(s, E);
+    if (cacheSets == NULL) {
+        printError("Unable to allocate cache");
+        return 1;
+    }
+    Prefetcher_t* pf = NULL;
+    if (prefetch) {
+        pf = prefetchCreate(prefetch, cacheSets, &index, E, b);
+        if (pf == NULL) {
+            printError("Invalid prefetcher. Use next[:degree], stride[:degree] or stream[:buffers[:depth]]");
+            return 1;
+        }
+    }
+    Tlb_t* tlb = NULL;
+    if (tlbSpec) {
+        tlb = tlbCreate(tlbSpec, page);
+        if (tlb == NULL) {
+            printError("Invalid TLB. Use -T entries:ways[,entries:ways] and -g 4K, 2M or 1G");
+            return 1;
+        }
+    }
+    Victim_t* vc = NULL;
+    if (victim) {
+        vc = victimCreate(victim, &index, E);
+        if (vc == NULL) {
+            printError("Invalid victim cache. Use -V victim[:entries] or -V miss[:entries], at most 64 entries");
+            return 1;
+        }
+    }
 
-    int hit_count = 0;
-    int miss_count = 0;
-    int eviction_count = 0;
+    // long, as traces can run past 2^31 accesses
+    long hit_count = 0;
+    long miss_count = 0;
+    long eviction_count = 0;
+    Access_t* batch = malloc(BATCH_SIZE * sizeof(Access_t));
+    if (batch == NULL) {
+        printError("Unable to allocate trace batch");
+        return 1;
+    }
     // End initialization
 
-    // Read in trace line-by-line and simulate cache
-    FILE* traceFile = fopen(trace, "r");
-    char buff[MAX_LENGTH];
-    if (traceFile) {
-        while (fgets(buff, MAX_LENGTH, traceFile)) {
-            // Ignore instruction lines
-            if (buff[0] != ' ') {
-                continue;
-            }
+    // Simulate the trace a batch at a time: decode a block of accesses,
+    // compute their sets and tags and prefetch those sets, then resolve
+    // the lookups in trace order. Prefetching the whole batch up front
+    // overlaps the host cache misses of large simulated caches. The
+    // reader detects compressed traces and decodes them on its own thread.
+    TraceReader_t* traceFile = traceOpen(trace);
+    if (traceFile == NULL) {
+        return 1;
+    }
+    if (v && format == FORMAT_BIN) {
+        fwrite(EVENT_BIN_MAGIC, 1, strlen(EVENT_BIN_MAGIC), stdout);
+    }
+    int count;
+    while ((count = decodeBatch(traceFile, batch,
+                    v && format == FORMAT_TEXT)) > 0) {
+        indexBatch(batch, count, cacheSets, E, &index, b);
+        resolveBatch(batch, count, cacheSets, E, v, format, pf, vc,
+                &hit_count, &miss_count, &eviction_count);
+        // the TLB translates the same accesses in the same pass
+        for (int i = 0; tlb && i < count; i++) {
+            tlbAccess(tlb, batch[i].address);
+        }
+    }
+    if (traceClose(traceFile)) {
+        printError("Error reading trace file");
+        return 1;
+    }
+    free(batch);
+    free(cacheSets);
 
-            char instruction;
-            char addStr[MAX_LENGTH];
-            sscanf(buff, " %c %s", &instruction, addStr);
-            addStr[strcspn(addStr, ",")] = 0;
-
-            char line[MAX_LENGTH];
-            strcpy(line, buff);
-            memmove(line, line+1, strlen(line));
-            line[strcspn(line, "\n")] = 0;
-
-            // extract instruction data
-            // parse address
-            unsigned long address = strtoul(addStr, NULL, 16);
-            // extract set
-            long set = extract(address, s, b);
-            // extract tag
-            long tag = extract(address, 64-(s+b), s+b);
-
-            // Validate set
-            if (set >= set_count) {
-                printError(strcat("Invalid set: ", buff));
-                return 2;
-            }
+    // Print Summary. A binary event stream keeps stdout to itself, so
+    // its summary goes to stderr.
+    if (format == FORMAT_TEXT) {
+        if (pf) {
+            printf("prefetch issued:%ld useful:%ld useless:%ld polluting:%ld\n",
+                    pf->issued, pf->useful, pf->useless, pf->polluting);
+        }
+        if (tlb) {
+            tlbPrintSummary(tlb);
+        }
+        if (vc) {
+            victimPrintSummary(vc);
+        }
+        printLongSummary(hit_count, miss_count, eviction_count);
+    } else {
+        printJsonSummary(format == FORMAT_BIN ? stderr : stdout, hit_count,
+                miss_count, eviction_count, pf, tlb, vc);
+        saveResults(hit_count, miss_count, eviction_count);
+    }
+    if (pf) {
+        prefetchFree(pf);
+    }
+    if (tlb) {
+        tlbFree(tlb);
+    }
+    if (vc) {
+        victimFree(vc);
+    }
+    return 0;
+}
 
-            // Determine which operation to perform
-            char res_out[MAX_LENGTH];
-            char* result;
-            char* tmp;
-            switch (instruction)
-            {
-            case 'L':
-                // Load data
-                result = loadOrSaveData(cacheSets, tag, set, E, 
-                        &hit_count, &miss_count, &eviction_count);
-                strcpy(res_out, result);
-                break;
-            case 'S':
-                // Store data
-                result = loadOrSaveData(cacheSets, tag, set, E, 
-                        &hit_count, &miss_count, &eviction_count);
-                strcpy(res_out, result);
-                break;
-            case 'M':
-                // Modify data  
-                result = loadOrSaveData(cacheSets, tag, set, E, &hit_count,
-                         &miss_count, &eviction_count);
-                tmp = loadOrSaveData(cacheSets, tag, set, E, &hit_count,
-                         &miss_count, &eviction_count);
-                strcpy(res_out, result);
-                strcat(res_out, " ");
-                strcat(res_out, tmp);
-                break;
-            default:
-                // If not valid instruction, skip.
-                // Should never get here.
-                printError(strcat("Invalid instruction found: ", buff));
-                break;
+// Decode up to BATCH_SIZE data accesses from a text or binary trace,
+// skipping instruction fetches, keeping the trace text for text verbose
+// output. Returns the number decoded, 0 at end of trace.
+int decodeBatch(TraceReader_t* traceFile, Access_t batch[], int text) {
+    int count = 0;
+    TraceRecord_t rec;
+    while (count < BATCH_SIZE && traceNext(traceFile, &rec)) {
+        batch[count].instruction = rec.op;
+        batch[count].address = rec.address;
+        batch[count].size = rec.size;
+        if (text) {
+            // binary traces carry no text, so print them lackey style
+            if (rec.text) {
+                snprintf(batch[count].line, MAX_LENGTH, "%s", rec.text);
+            } else {
+                snprintf(batch[count].line, MAX_LENGTH, "%c %lx,%d", rec.op,
+                        rec.address, rec.size);
             }
-            if (v) {
-                printf("%s %s\n", line, res_out);
-            }
-            traceLine++;
         }
+        count++;
     }
-    fclose(traceFile);
+    return count;
+}
 
-    // Print Summary
-    printSummary(hit_count, miss_count, eviction_count);
-    return 0;
+// Compute the set and tag of each access, with shift masks unless the
+// set index is hashed, and prefetch the set's lines, so the lookups in
+// resolveBatch find them in cache.
+void indexBatch(Access_t batch[], int count, Line_t cacheSets[], int E,
+         const SetIndex_t* index, int b) {
+    if (index->hash != HASH_BITS) {
+        for (int i = 0; i < count; i++) {
+            blockToSet(index, batch[i].address >> b, &batch[i].set,
+                    &batch[i].tag);
+            __builtin_prefetch(&cacheSets[batch[i].set * E], 1);
+        }
+        return;
+    }
+    int s = index->s;
+    unsigned long set_mask = (1UL << s) - 1;
+    for (int i = 0; i < count; i++) {
+        batch[i].set = (batch[i].address >> b) & set_mask;
+        batch[i].tag = batch[i].address >> (s + b);
+        __builtin_prefetch(&cacheSets[batch[i].set * E], 1);
+    }
+}
+
+// Perform the cache lookups of a batch in trace order, training the
+// prefetcher, if any, on each access once it is resolved
+void resolveBatch(Access_t batch[], int count, Line_t cacheSets[], int E,
+         int v, enum Format format, Prefetcher_t* pf, Victim_t* vc,
+         long* hit_count_p, long* miss_count_p, long* eviction_count_p) {
+    for (int i = 0; i < count; i++) {
+        long set = batch[i].set;
+        long tag = batch[i].tag;
+
+        // Load or store data; modify is a load followed by a store to
+        // the same block
+        int first = loadOrSaveData(cacheSets, tag, set, E, pf, vc,
+                hit_count_p, miss_count_p, eviction_count_p);
+        int second = -1;
+        if (batch[i].instruction == 'M') {
+            second = loadOrSaveData(cacheSets, tag, set, E, pf, vc,
+                    hit_count_p, miss_count_p, eviction_count_p);
+        }
+        if (pf) {
+            prefetchTrain(pf, batch[i].address,
+                    first == RESULT_MISS || first == RESULT_MISS_EVICTION,
+                    traceLine);
+        }
+        if (v) {
+            printEvent(&batch[i], first, second, format);
+        }
+        traceLine++;
+    }
+}
+
+// Write the verbose event of one access: the trace line followed by its
+// results, a JSON object per line, or a packed 64-bit word. second is
+// the store result of a modify, -1 for loads and stores.
+void printEvent(Access_t* access, int first, int second, enum Format format) {
+    switch (format)
+    {
+    case FORMAT_TEXT:
+        if (second < 0) {
+            printf("%s %s\n", access->line, resultNames[first]);
+        } else {
+            printf("%s %s %s\n", access->line, resultNames[first],
+                    resultNames[second]);
+        }
+        break;
+    case FORMAT_JSON:
+        printf("{\"op\":\"%c\",\"address\":%lu,\"size\":%d,\"results\":[\"%s\"",
+                access->instruction, access->address, access->size,
+                resultNames[first]);
+        if (second >= 0) {
+            printf(",\"%s\"", resultNames[second]);
+        }
+        printf("]}\n");
+        break;
+    case FORMAT_BIN: {
+        int op = access->instruction == 'L' ? TRACE_OP_LOAD
+                : access->instruction == 'S' ? TRACE_OP_STORE
+                : TRACE_OP_MODIFY;
+        unsigned long long word = EVENT_PACK(op, access->size, first,
+                second < 0 ? 0 : second, access->address);
+        fwrite(&word, sizeof(word), 1, stdout);
+        break;
+    }
+    }
+}
+
+// Print the totals, and the counts of any prefetcher, TLB or victim
+// cache, as a single JSON object
+void printJsonSummary(FILE* out, long hits, long misses, long evictions,
+         Prefetcher_t* pf, Tlb_t* tlb, Victim_t* vc) {
+    fprintf(out, "{\"hits\":%ld,\"misses\":%ld,\"evictions\":%ld",
+            hits, misses, evictions);
+    if (pf) {
+        fprintf(out, ",\"prefetch\":{\"issued\":%ld,\"useful\":%ld,"
+                "\"useless\":%ld,\"polluting\":%ld}",
+                pf->issued, pf->useful, pf->useless, pf->polluting);
+    }
+    if (tlb) {
+        fprintf(out, ",");
+        tlbPrintJson(tlb, out);
+    }
+    if (vc) {
+        fprintf(out, ",");
+        victimPrintJson(vc, out);
+    }
+    fprintf(out, "}\n");
 }
 
-char* loadOrSaveData(Line_t cacheSets[], long tag, long set, int E,
-         int* hit_count_p, int* miss_count_p, int* eviction_count_p) {
+int loadOrSaveData(Line_t cacheSets[], long tag, long set, int E,
+         Prefetcher_t* pf, Victim_t* vc,
+         long* hit_count_p, long* miss_count_p, long* eviction_count_p) {
     int leastRecentIndex = 0;
     long oldestTime = LONG_MAX;
+    int conflict = vc && victimShadow(vc, set, tag);
     // iterate through set lines
     for (int line = 0; line < E; line++) {
         // get line
@@ -211,7 +560,10 @@ char* loadOrSaveData(Line_t cacheSets[], long tag, long set, int E,
                 // update hit count, last_used, and return
                 *hit_count_p = *hit_count_p + 1;
                 cacheSets[set * E + line].last_used = traceLine;
-                return "hit";
+                if (pf) {
+                    prefetchDemandHit(pf, &cacheSets[set * E + line]);
+                }
+                return RESULT_HIT;
             }
         }
         if (setLine.last_used < oldestTime) {
@@ -220,20 +572,40 @@ char* loadOrSaveData(Line_t cacheSets[], long tag, long set, int E,
             leastRecentIndex = line;
         }
     }
-    // no valid and matching tab, miss
-    *miss_count_p = *miss_count_p + 1;
+    // no valid and matching tab, miss unless a stream buffer, victim
+    // cache or miss cache supplies it
+    if (conflict) {
+        vc->conflicts++;
+    }
+    int served = pf && prefetchStreamHit(pf, set, tag, traceLine);
+    if (!served && vc) {
+        served = victimMiss(vc, set, tag,
+                &cacheSets[set * E + leastRecentIndex]);
+        if (served && conflict) {
+            vc->absorbed_conflicts++;
+        }
+    }
+    if (served) {
+        *hit_count_p = *hit_count_p + 1;
+    } else {
+        *miss_count_p = *miss_count_p + 1;
+    }
     if (!cacheSets[set * E + leastRecentIndex].valid) {
         // open lines available
         cacheSets[set * E + leastRecentIndex].valid = 1;
         cacheSets[set * E + leastRecentIndex].tag = tag;
         cacheSets[set * E + leastRecentIndex].last_used = traceLine;
-        return "miss";
+        cacheSets[set * E + leastRecentIndex].prefetched = 0;
+        return served ? RESULT_HIT : RESULT_MISS;
     } else {
         // no open line, evict oldest
+        if (pf) {
+            prefetchEvicting(pf, &cacheSets[set * E + leastRecentIndex]);
+        }
         evict(cacheSets, tag, set, E, leastRecentIndex);
         // update evict count
         *eviction_count_p = *eviction_count_p + 1;
-        return "miss eviction";
+        return served ? RESULT_HIT_EVICTION : RESULT_MISS_EVICTION;
     }    
 }
 
@@ -241,23 +613,150 @@ void evict(Line_t cacheSets[], long tag, long set, int E, int line) {
     cacheSets[set * E + line].valid = 1;
     cacheSets[set * E + line].tag = tag;
     cacheSets[set * E + line].last_used = traceLine;
+    cacheSets[set * E + line].prefetched = 0;
 }
 
-void initializeCache(Line_t sets[], int set_count, int E) {
-    for (int set = 0; set < set_count; set++) {
-        for (int lineOffset = 0; lineOffset < E; lineOffset++) {
-            sets[set * E + lineOffset].valid = 0;
-            sets[set * E + lineOffset].last_used = -1;
+// Simulate private caches kept coherent with MESI or MOESI. With one
+// trace per core the traces are interleaved round-robin, quantum
+// accesses per turn; a single trace is replayed in order, each record
+// running on the core it is tagged with.
+int simulateMultiCore(char* traces[], int trace_count, int cores,
+         int quantum, int moesi, int s, int E, int b, int v) {
+    Coherent_t* coherent = coherentCreate(cores, s, E, b, moesi);
+    if (coherent == NULL) {
+        printError("Unable to allocate cache");
+        return 1;
+    }
+    TraceReader_t* readers[MAX_CORES];
+    for (int i = 0; i < trace_count; i++) {
+        readers[i] = traceOpen(traces[i]);
+        if (readers[i] == NULL) {
+            return 1;
+        }
+    }
+
+    char res_out[MAX_LENGTH];
+    TraceRecord_t rec;
+    int live = trace_count;
+    int turn = 0;
+    while (live > 0) {
+        int core = turn;
+        int source = trace_count > 1 ? turn : 0;
+        for (int n = 0; n < quantum; n++) {
+            if (readers[source] == NULL || !traceNext(readers[source], &rec)) {
+                if (readers[source] && traceClose(readers[source])) {
+                    printError("Error reading trace file");
+                    return 1;
+                }
+                if (readers[source]) {
+                    live--;
+                }
+                readers[source] = NULL;
+                break;
+            }
+            if (trace_count == 1) {
+                // only binary records carry a core tag; a text trace
+                // would run entirely on core 0
+                if (!traceIsBinary(readers[0])) {
+                    printError("-c needs a binary trace tagged by core, or one -t per core");
+                    return 1;
+                }
+                core = rec.cpu;
+                if (core >= cores) {
+                    fprintf(stderr, "Access tagged for core %d, but -c is %d\n",
+                            core, cores);
+                    return 1;
+                }
+            }
+            coherentAccess(coherent, core, rec.op, rec.address,
+                    v ? res_out : NULL);
+            if (v) {
+                if (rec.text) {
+                    printf("%d %s %s\n", core, rec.text, res_out);
+                } else {
+                    printf("%d %c %lx,%d %s\n", core, rec.op, rec.address,
+                            rec.size, res_out);
+                }
+            }
+        }
+        if (trace_count > 1) {
+            turn = (turn + 1) % trace_count;
         }
     }
+
+    // Per-core coherence statistics, then the usual totals
+    long hits = 0, misses = 0, evictions = 0;
+    for (int core = 0; core < cores; core++) {
+        CoreStats_t* st = &coherent->stats[core];
+        printf("core %d: hits:%ld misses:%ld evictions:%ld coherence_misses:%ld "
+                "invalidations:%ld upgrades:%ld writebacks:%ld transfers:%ld\n",
+                core, st->hits, st->misses, st->evictions, st->coherence_misses,
+                st->invalidations, st->upgrades, st->writebacks, st->transfers);
+        hits += st->hits;
+        misses += st->misses;
+        evictions += st->evictions;
+    }
+    coherentFree(coherent);
+    printLongSummary(hits, misses, evictions);
+    return 0;
 }
 
-long extract(int num, int length, int offset) {
-    unsigned long mask = pow(2, length);
-    mask--;
-    long res = num >> offset;
-    res = res & mask;
-    return res;
+/*
+ * analyzeReuse - Write the block reuse distance histogram of a trace to
+ *     <prefix>-reuse.csv and its working set curve to <prefix>-wss.csv.
+ *     A modify is a load and a store, so counts as two accesses.
+ */
+int analyzeReuse(char* trace, int b, long window, char* prefix) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s-wss.csv", prefix);
+    FILE* wss = fopen(path, "w");
+    if (wss == NULL) {
+        perror(path);
+        return 1;
+    }
+    Reuse_t* r = reuseCreate(b, window, wss);
+    if (r == NULL) {
+        printError("Unable to allocate reuse analysis");
+        fclose(wss);
+        return 1;
+    }
+    TraceReader_t* traceFile = traceOpen(trace);
+    if (traceFile == NULL) {
+        reuseFree(r);
+        fclose(wss);
+        return 1;
+    }
+    // a batch holds BATCH_SIZE records, each one or two accesses
+    unsigned long addresses[2 * BATCH_SIZE];
+    int count;
+    do {
+        TraceRecord_t rec;
+        count = 0;
+        while (count < BATCH_SIZE && traceNext(traceFile, &rec)) {
+            addresses[count++] = rec.address;
+            if (rec.op == 'M') {
+                addresses[count++] = rec.address;
+            }
+        }
+        reuseAccess(r, addresses, count);
+    } while (count > 0);
+    int failed = traceClose(traceFile);
+    reuseFinish(r);
+    fclose(wss);
+
+    snprintf(path, sizeof(path), "%s-reuse.csv", prefix);
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        reuseFree(r);
+        return 1;
+    }
+    reuseWriteHistogram(r, out);
+    fclose(out);
+    printf("accesses:%ld blocks:%ld cold_misses:%ld\n", r->accesses,
+            r->blocks, r->cold);
+    reuseFree(r);
+    return failed;
 }
 
 void printHelp() {
@@ -267,7 +766,32 @@ void printHelp() {
     printf("\t-s <s>\t\tNumber of set index bits (S = 2^s is number of sets)\n");
     printf("\t-E <E>\t\tAssociativity (number of lines per set)\n");
     printf("\t-b <b>\t\tNumber of block bits (B = 2^b is block size)\n");
-    printf("\t-t <tracefile>\tName of valgrind trace to replay\n");
+    printf("\t-t <tracefile>\tName of valgrind trace to replay, may be gzip,\n");
+    printf("\t\t\tzstd or lz4 compressed, or - for stdin. Repeat for one\n");
+    printf("\t\t\ttrace per core in multi-core mode\n");
+    printf("\t-c <cores>\tSimulate coherent per-core caches; a single binary\n");
+    printf("\t\t\ttrace is split by the thread tag of each record\n");
+    printf("\t-P <protocol>\tCoherence protocol, mesi (default) or moesi\n");
+    printf("\t-q <quantum>\tAccesses per core turn when interleaving traces\n");
+    printf("\t-p <model>\tPrefetcher: next[:degree], stride[:degree] or\n");
+    printf("\t\t\tstream[:buffers[:depth]]\n");
+    printf("\t-T <levels>\tTLB levels as entries:ways, dTLB first, e.g.\n");
+    printf("\t\t\t64:4,1536:12 for a dTLB backed by an STLB\n");
+    printf("\t-g <page>\tTLB page size, 4K (default), 2M or 1G\n");
+    printf("\t-V <buffer>\tFully associative victim[:entries] or\n");
+    printf("\t\t\tmiss[:entries] cache beside the main cache,\n");
+    printf("\t\t\tnot with -p\n");
+    printf("\t-H <hash>\tSet index: bits (default), xor folded or prime\n");
+    printf("\t\t\tmodulo\n");
+    printf("\t-R <prefix>\tInstead of simulating, write the reuse distance\n");
+    printf("\t\t\thistogram and working set curve of blocks of 2^b\n");
+    printf("\t\t\tbytes to <prefix>-reuse.csv and <prefix>-wss.csv\n");
+    printf("\t-w <window>\tAccesses per working set window (default 10000)\n");
+    printf("\t-o <format>\tOutput format: text (default), json for a JSON\n");
+    printf("\t\t\tsummary and, with -v, one JSON event per access, or\n");
+    printf("\t\t\tbin for packed 64-bit -v events with the JSON summary\n");
+    printf("\t\t\ton stderr\n");
+    printf("\t-n\t\tDo not write the .csim_results file\n");
 }
 
 void printError(char* msg) {
@@ -0,0 +1,190 @@
+/*
+ * mesi.c - Multi-core cache simulation with MESI/MOESI coherence
+ *
+ * The caches are kept coherent by snooping: a load miss downgrades the
+ * other copies to Shared (a Modified copy is written back first, or
+ * becomes Owned under MOESI), and a store miss or a store to a Shared or
+ * Owned line invalidates every other copy. A dirty copy that supplies a
+ * store miss hands its data over with ownership, so it is not written
+ * back.
+ *
+ * A line invalidated by another core keeps its tag, which is how a later
+ * miss on it is recognised as a coherence miss.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "mesi.h"
+
+static void accessOnce(Coherent_t* c, int core, long set, long tag,
+        int store, char* res_out);
+static int invalidateOthers(Coherent_t* c, int core, long set, long tag);
+static void appendResult(char* res_out, const char* word);
+
+Coherent_t* coherentCreate(int cores, int s, int E, int b, int moesi) {
+    Coherent_t* c = calloc(1, sizeof(Coherent_t));
+    if (c == NULL) {
+        return NULL;
+    }
+    c->cores = cores;
+    c->s = s;
+    c->E = E;
+    c->b = b;
+    c->moesi = moesi;
+    for (int core = 0; core < cores; core++) {
+        c->sets[core] = allocateCache(s, E);
+        if (c->sets[core] == NULL) {
+            coherentFree(c);
+            return NULL;
+        }
+    }
+    return c;
+}
+
+void coherentFree(Coherent_t* c) {
+    for (int core = 0; core < c->cores; core++) {
+        free(c->sets[core]);
+    }
+    free(c);
+}
+
+void coherentAccess(Coherent_t* c, int core, char op, unsigned long address,
+        char* res_out) {
+    long set = (address >> c->b) & ((1UL << c->s) - 1);
+    long tag = address >> (c->s + c->b);
+    if (res_out) {
+        res_out[0] = 0;
+    }
+    // Modify is a load followed by a store to the same block
+    if (op == 'L' || op == 'M') {
+        accessOnce(c, core, set, tag, 0, res_out);
+    }
+    if (op == 'S' || op == 'M') {
+        accessOnce(c, core, set, tag, 1, res_out);
+    }
+}
+
+/* Perform a single load or store by core */
+static void accessOnce(Coherent_t* c, int core, long set, long tag,
+        int store, char* res_out) {
+    Line_t* mine = &c->sets[core][set * c->E];
+    CoreStats_t* stats = &c->stats[core];
+    c->clock++;
+
+    int line = findLine(mine, c->E, tag);
+    if (line >= 0) {
+        stats->hits++;
+        mine[line].last_used = c->clock;
+        appendResult(res_out, "hit");
+        if (store) {
+            if (mine[line].state == STATE_S || mine[line].state == STATE_O) {
+                // other copies may exist and must be invalidated
+                invalidateOthers(c, core, set, tag);
+                stats->upgrades++;
+                appendResult(res_out, "upgrade");
+            }
+            mine[line].state = STATE_M;
+        }
+        return;
+    }
+
+    stats->misses++;
+    appendResult(res_out, "miss");
+    int coherence = -1;
+    for (int i = 0; i < c->E; i++) {
+        if (!mine[i].valid && mine[i].tag == tag) {
+            coherence = i;
+        }
+    }
+
+    // Snoop the other caches
+    int shared = 0;
+    if (store) {
+        if (invalidateOthers(c, core, set, tag)) {
+            stats->transfers++;
+        }
+    } else {
+        for (int other = 0; other < c->cores; other++) {
+            if (other == core) {
+                continue;
+            }
+            Line_t* theirs = &c->sets[other][set * c->E];
+            int l = findLine(theirs, c->E, tag);
+            if (l < 0) {
+                continue;
+            }
+            shared = 1;
+            switch (theirs[l].state)
+            {
+            case STATE_M:
+                stats->transfers++;
+                if (c->moesi) {
+                    theirs[l].state = STATE_O;
+                } else {
+                    c->stats[other].writebacks++;
+                    theirs[l].state = STATE_S;
+                }
+                break;
+            case STATE_O:
+                stats->transfers++;
+                break;
+            default:
+                theirs[l].state = STATE_S;
+                break;
+            }
+        }
+    }
+
+    // refill the invalidated copy if there is one, so no stale tag remains
+    line = coherence >= 0 ? coherence : victimLine(mine, c->E);
+    if (mine[line].valid) {
+        stats->evictions++;
+        appendResult(res_out, "eviction");
+        if (mine[line].state == STATE_M || mine[line].state == STATE_O) {
+            stats->writebacks++;
+        }
+    }
+    if (coherence >= 0) {
+        stats->coherence_misses++;
+        appendResult(res_out, "coherence");
+    }
+    mine[line].valid = 1;
+    mine[line].tag = tag;
+    mine[line].last_used = c->clock;
+    mine[line].state = store ? STATE_M : shared ? STATE_S : STATE_E;
+}
+
+/*
+ * invalidateOthers - Invalidate every other core's copy of a block.
+ *     Returns whether one of them was dirty and supplied the data.
+ */
+static int invalidateOthers(Coherent_t* c, int core, long set, long tag) {
+    int dirty = 0;
+    for (int other = 0; other < c->cores; other++) {
+        if (other == core) {
+            continue;
+        }
+        Line_t* theirs = &c->sets[other][set * c->E];
+        int l = findLine(theirs, c->E, tag);
+        if (l < 0) {
+            continue;
+        }
+        if (theirs[l].state == STATE_M || theirs[l].state == STATE_O) {
+            dirty = 1;
+        }
+        // keep the tag so the next miss on it counts as a coherence miss
+        theirs[l].valid = 0;
+        theirs[l].state = STATE_I;
+        c->stats[other].invalidations++;
+    }
+    return dirty;
+}
+
+static void appendResult(char* res_out, const char* word) {
+    if (res_out == NULL) {
+        return;
+    }
+    if (res_out[0]) {
+        strcat(res_out, " ");
+    }
+    strcat(res_out, word);
+}
@@ -0,0 +1,57 @@
+/*
+ * mesi.h - Multi-core cache simulation with MESI/MOESI coherence
+ *
+ * Each core has a private cache built from the set/line model in
+ * cache.h. Accesses are applied one at a time in the order the caller
+ * chooses, and every miss or upgrade snoops the other cores' caches, so
+ * a given interleaving always produces the same result.
+ */
+
+#ifndef MESI_H
+#define MESI_H
+
+#include "cache.h"
+
+/* Largest core count; binary traces tag records with 4 bits */
+#define MAX_CORES 16
+
+/* Per-core statistics */
+struct CoreStats {
+    long hits;
+    long misses;
+    long evictions;
+    long coherence_misses;  /* misses on a block another core invalidated */
+    long invalidations;     /* lines of this core invalidated by others */
+    long upgrades;          /* stores to shared lines that had to
+                               invalidate the other copies */
+    long writebacks;        /* dirty lines written back to memory */
+    long transfers;         /* misses served from another core's dirty line */
+};
+typedef struct CoreStats CoreStats_t;
+
+struct Coherent {
+    int cores;
+    int s;
+    int E;
+    int b;
+    int moesi;              /* use the Owned state instead of writing back
+                               a modified line another core reads */
+    Line_t* sets[MAX_CORES];
+    CoreStats_t stats[MAX_CORES];
+    long clock;
+};
+typedef struct Coherent Coherent_t;
+
+/* Create cores private s/E/b caches. Returns NULL if out of memory. */
+Coherent_t* coherentCreate(int cores, int s, int E, int b, int moesi);
+void coherentFree(Coherent_t* c);
+
+/*
+ * coherentAccess - Apply one trace access ('L', 'S' or 'M') by core.
+ *     When res_out is not NULL, the outcome words ("hit", "miss",
+ *     "eviction", "upgrade", "coherence") are written to it.
+ */
+void coherentAccess(Coherent_t* c, int core, char op, unsigned long address,
+        char* res_out);
+
+#endif /* MESI_H */
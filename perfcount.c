@@ -0,0 +1,103 @@
+/*
+ * perfcount.c - Hardware cache and TLB miss counters for test-trans
+ */
+#define _GNU_SOURCE
+#include <string.h>
+#include <unistd.h>
+#include "perfcount.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+/* perf_event_open configs of the events, in enum PerfEvent order */
+static const unsigned long long configs[PERF_EVENTS] = {
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+};
+
+void perfOpen(perf_counters_t* pc)
+{
+    struct perf_event_attr attr;
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        pc->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+void perfClose(perf_counters_t* pc)
+{
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++)
+        if (pc->fd[i] >= 0)
+            close(pc->fd[i]);
+}
+
+static void perfControl(perf_counters_t* pc, unsigned long request)
+{
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++)
+        if (pc->fd[i] >= 0)
+            ioctl(pc->fd[i], request, 0);
+}
+
+void perfReset(perf_counters_t* pc)
+{
+    perfControl(pc, PERF_EVENT_IOC_RESET);
+}
+
+void perfStart(perf_counters_t* pc)
+{
+    perfControl(pc, PERF_EVENT_IOC_ENABLE);
+}
+
+void perfStop(perf_counters_t* pc)
+{
+    perfControl(pc, PERF_EVENT_IOC_DISABLE);
+}
+
+void perfRead(perf_counters_t* pc, long long counts[PERF_EVENTS])
+{
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++) {
+        counts[i] = -1;
+        if (pc->fd[i] >= 0 &&
+            read(pc->fd[i], &counts[i], sizeof(counts[i])) != sizeof(counts[i]))
+            counts[i] = -1;
+    }
+}
+
+#else /* no perf_event_open: every event is unavailable */
+
+void perfOpen(perf_counters_t* pc)
+{
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++)
+        pc->fd[i] = -1;
+}
+
+void perfClose(perf_counters_t* pc) {}
+void perfReset(perf_counters_t* pc) {}
+void perfStart(perf_counters_t* pc) {}
+void perfStop(perf_counters_t* pc) {}
+
+void perfRead(perf_counters_t* pc, long long counts[PERF_EVENTS])
+{
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++)
+        counts[i] = -1;
+}
+
+#endif
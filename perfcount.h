@@ -0,0 +1,38 @@
+/*
+ * perfcount.h - Hardware cache and TLB miss counters for test-trans
+ *
+ * The counters come from perf_event_open and only count user-space
+ * events of the calling thread. Where the kernel, the CPU or a virtual
+ * machine does not provide an event, it reads as -1.
+ */
+
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+enum PerfEvent {
+    PERF_L1D_MISS,      /* L1 data cache read misses */
+    PERF_LLC_MISS,      /* last level cache read misses */
+    PERF_DTLB_MISS,     /* data TLB read misses */
+    PERF_EVENTS
+};
+
+struct perf_counters {
+    int fd[PERF_EVENTS];
+};
+typedef struct perf_counters perf_counters_t;
+
+/* Open the counters, stopped and at zero */
+void perfOpen(perf_counters_t* pc);
+void perfClose(perf_counters_t* pc);
+
+/* Zero the counters */
+void perfReset(perf_counters_t* pc);
+
+/* Count between perfStart and perfStop; counts accumulate until reset */
+void perfStart(perf_counters_t* pc);
+void perfStop(perf_counters_t* pc);
+
+/* Read the counts, -1 for an unavailable event */
+void perfRead(perf_counters_t* pc, long long counts[PERF_EVENTS]);
+
+#endif /* PERFCOUNT_H */
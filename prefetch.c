@@ -0,0 +1,235 @@
+/*
+ * prefetch.c - Hardware prefetcher models for the cache simulator
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prefetch.h"
+
+/* log2 of the region size the stride table tracks */
+#define REGION_BITS 12
+
+static void prefetchBlock(Prefetcher_t* pf, long block, long now);
+static void restartStream(Prefetcher_t* pf, long block, long now);
+
+Prefetcher_t* prefetchCreate(const char* spec, Line_t* cacheSets,
+        const SetIndex_t* index, int E, int b) {
+    Prefetcher_t* pf = calloc(1, sizeof(Prefetcher_t));
+    if (pf == NULL) {
+        return NULL;
+    }
+    char name[16];
+    int first = 0, second = 0;
+    int used = 0;
+    int fields = sscanf(spec, "%15[a-z]%n", name, &used);
+    // each :number must parse whole, so next:x is not taken as next
+    while (fields >= 1 && fields < 3 && spec[used] == ':') {
+        int more = 0;
+        if (sscanf(spec + used, ":%d%n", fields == 1 ? &first : &second,
+                    &more) != 1) {
+            break;
+        }
+        used += more;
+        fields++;
+    }
+    if (fields < 1 || spec[used] != '\0') {
+        free(pf);
+        return NULL;
+    }
+    if (strcmp(name, "next") == 0 && fields <= 2) {
+        pf->kind = PREFETCH_NEXT;
+        pf->degree = fields > 1 ? first : 1;
+    } else if (strcmp(name, "stride") == 0 && fields <= 2) {
+        pf->kind = PREFETCH_STRIDE;
+        pf->degree = fields > 1 ? first : 2;
+    } else if (strcmp(name, "stream") == 0) {
+        pf->kind = PREFETCH_STREAM;
+        pf->streams = fields > 1 ? first : 4;
+        pf->degree = fields > 2 ? second : 4;
+    } else {
+        free(pf);
+        return NULL;
+    }
+    if (pf->degree < 1 || pf->degree > MAX_STREAM_DEPTH ||
+            (pf->kind == PREFETCH_STREAM &&
+             (pf->streams < 1 || pf->streams > MAX_STREAMS))) {
+        free(pf);
+        return NULL;
+    }
+
+    pf->cacheSets = cacheSets;
+    pf->index = *index;
+    pf->E = E;
+    pf->b = b;
+    for (int i = 0; i < STRIDE_ENTRIES; i++) {
+        pf->stride[i].region = -1;
+    }
+    for (int i = 0; i < POLLUTION_ENTRIES; i++) {
+        pf->evicted[i] = -1;
+    }
+    return pf;
+}
+
+void prefetchFree(Prefetcher_t* pf) {
+    free(pf);
+}
+
+void prefetchDemandHit(Prefetcher_t* pf, Line_t* line) {
+    if (line->prefetched) {
+        line->prefetched = 0;
+        pf->useful++;
+        pf->tagged_hit = 1;
+    }
+}
+
+void prefetchEvicting(Prefetcher_t* pf, Line_t* line) {
+    if (line->valid && line->prefetched) {
+        pf->useless++;
+    }
+}
+
+int prefetchStreamHit(Prefetcher_t* pf, long set, long tag, long now) {
+    if (pf->kind != PREFETCH_STREAM) {
+        return 0;
+    }
+    long block = setToBlock(&pf->index, set, tag);
+    for (int i = 0; i < pf->streams; i++) {
+        struct StreamBuffer* sb = &pf->stream[i];
+        if (sb->count == 0 || sb->blocks[sb->head] != block) {
+            continue;
+        }
+        // pop the head and fetch one more block at the tail
+        pf->useful++;
+        sb->head = (sb->head + 1) % pf->degree;
+        sb->count--;
+        int tail = (sb->head + sb->count) % pf->degree;
+        sb->blocks[tail] = sb->next_block++;
+        sb->count++;
+        sb->last_used = now;
+        pf->issued++;
+        return 1;
+    }
+    return 0;
+}
+
+void prefetchTrain(Prefetcher_t* pf, unsigned long address, int miss,
+        long now) {
+    long block = address >> pf->b;
+    int tagged_hit = pf->tagged_hit;
+    pf->tagged_hit = 0;
+
+    // A miss on a block a prefetch pushed out is cache pollution
+    if (miss) {
+        long* slot = &pf->evicted[block % POLLUTION_ENTRIES];
+        if (*slot == block) {
+            pf->polluting++;
+            *slot = -1;
+        }
+    }
+
+    switch (pf->kind)
+    {
+    case PREFETCH_NEXT:
+        if (miss || tagged_hit) {
+            for (int k = 1; k <= pf->degree; k++) {
+                prefetchBlock(pf, block + k, now);
+            }
+        }
+        break;
+    case PREFETCH_STRIDE: {
+        long region = address >> REGION_BITS;
+        // fold the region number so regions a power of two apart, like
+        // the rows of a matrix, do not all share one entry
+        long index = (region ^ (region >> 6) ^ (region >> 12)) % STRIDE_ENTRIES;
+        struct StrideEntry* e = &pf->stride[index];
+        if (e->region != region) {
+            e->region = region;
+            e->last_block = block;
+            e->stride = 0;
+            e->confidence = 0;
+            break;
+        }
+        long delta = block - e->last_block;
+        if (delta == 0) {
+            break;
+        }
+        if (delta == e->stride) {
+            if (e->confidence < 3) {
+                e->confidence++;
+            }
+        } else {
+            e->stride = delta;
+            e->confidence = 0;
+        }
+        e->last_block = block;
+        if (e->confidence > 0) {
+            for (int k = 1; k <= pf->degree; k++) {
+                prefetchBlock(pf, block + k * e->stride, now);
+            }
+        }
+        break;
+    }
+    case PREFETCH_STREAM:
+        if (miss) {
+            restartStream(pf, block, now);
+        }
+        break;
+    }
+}
+
+/*
+ * prefetchBlock - Fill a block into the cache as a prefetch unless it
+ *     is already present. A demand line it evicts is remembered in the
+ *     pollution filter.
+ */
+static void prefetchBlock(Prefetcher_t* pf, long block, long now) {
+    if (block < 0) {
+        return;
+    }
+    long set, tag;
+    blockToSet(&pf->index, block, &set, &tag);
+    Line_t* lines = &pf->cacheSets[set * pf->E];
+    if (findLine(lines, pf->E, tag) >= 0) {
+        return;
+    }
+    pf->issued++;
+    Line_t* victim = &lines[victimLine(lines, pf->E)];
+    if (victim->valid) {
+        if (victim->prefetched) {
+            pf->useless++;
+        } else {
+            long evicted = setToBlock(&pf->index, set, victim->tag);
+            pf->evicted[evicted % POLLUTION_ENTRIES] = evicted;
+        }
+    }
+    // a block being refetched is no longer a pollution victim
+    if (pf->evicted[block % POLLUTION_ENTRIES] == block) {
+        pf->evicted[block % POLLUTION_ENTRIES] = -1;
+    }
+    victim->valid = 1;
+    victim->tag = tag;
+    victim->last_used = now;
+    victim->prefetched = 1;
+}
+
+/*
+ * restartStream - Point the least recently used stream buffer at the
+ *     blocks following a missed block
+ */
+static void restartStream(Prefetcher_t* pf, long block, long now) {
+    struct StreamBuffer* lru = &pf->stream[0];
+    for (int i = 1; i < pf->streams; i++) {
+        if (pf->stream[i].last_used < lru->last_used) {
+            lru = &pf->stream[i];
+        }
+    }
+    pf->useless += lru->count;
+    for (int k = 0; k < pf->degree; k++) {
+        lru->blocks[k] = block + 1 + k;
+    }
+    lru->head = 0;
+    lru->count = pf->degree;
+    lru->next_block = block + 1 + pf->degree;
+    lru->last_used = now;
+    pf->issued += pf->degree;
+}
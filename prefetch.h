@@ -0,0 +1,111 @@
+/*
+ * prefetch.h - Hardware prefetcher models for the cache simulator
+ *
+ * Three models are available:
+ *   next    next-line: a demand miss, or the first use of a prefetched
+ *           line, prefetches the following `degree` blocks
+ *   stride  PC-less stride detection: a table indexed by 4KB region
+ *           records the last block and block delta seen in the region,
+ *           and once a delta repeats the next `degree` blocks along it
+ *           are prefetched
+ *   stream  Jouppi stream buffers: a demand miss that matches the head
+ *           of a buffer is served from it, otherwise the least recently
+ *           used buffer is restarted on the blocks after the miss
+ *
+ * next and stride prefetch into the cache itself; stream buffers sit
+ * beside it and only move a block into the cache when it is demanded.
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "cache.h"
+
+enum PrefetchKind {
+    PREFETCH_NEXT,
+    PREFETCH_STRIDE,
+    PREFETCH_STREAM
+};
+
+/* Entries of the stride table and pollution filter */
+#define STRIDE_ENTRIES 64
+#define POLLUTION_ENTRIES 4096
+/* Largest stream buffer count and depth */
+#define MAX_STREAMS 16
+#define MAX_STREAM_DEPTH 32
+
+struct StrideEntry {
+    long region;
+    long last_block;
+    long stride;
+    int confidence;
+};
+
+struct StreamBuffer {
+    long blocks[MAX_STREAM_DEPTH];   /* FIFO of prefetched blocks */
+    int head;
+    int count;
+    long next_block;                 /* next block to fetch at the tail */
+    long last_used;
+};
+
+struct Prefetcher {
+    enum PrefetchKind kind;
+    int degree;             /* blocks per prefetch, or stream depth */
+    int streams;
+
+    /* cache the prefetcher fills */
+    Line_t* cacheSets;
+    SetIndex_t index;
+    int E;
+    int b;
+
+    struct StrideEntry stride[STRIDE_ENTRIES];
+    struct StreamBuffer stream[MAX_STREAMS];
+    /* demand blocks evicted by prefetch fills, to detect pollution */
+    long evicted[POLLUTION_ENTRIES];
+
+    int tagged_hit;         /* last demand hit used a prefetched line */
+
+    long issued;            /* prefetches that fetched a block */
+    long useful;            /* prefetched blocks later demanded */
+    long useless;           /* prefetched blocks dropped unused */
+    long polluting;         /* demand misses on blocks a prefetch evicted */
+};
+typedef struct Prefetcher Prefetcher_t;
+
+/*
+ * prefetchCreate - Parse a spec of the form "next[:degree]",
+ *     "stride[:degree]" or "stream[:buffers[:depth]]" and attach the
+ *     prefetcher to a cache. Returns NULL for an invalid spec.
+ */
+Prefetcher_t* prefetchCreate(const char* spec, Line_t* cacheSets,
+        const SetIndex_t* index, int E, int b);
+void prefetchFree(Prefetcher_t* pf);
+
+/*
+ * prefetchDemandHit - Note a demand hit on a line; the first use of a
+ *     prefetched line counts it useful
+ */
+void prefetchDemandHit(Prefetcher_t* pf, Line_t* line);
+
+/*
+ * prefetchEvicting - Note that a demand fill is about to evict a line
+ */
+void prefetchEvicting(Prefetcher_t* pf, Line_t* line);
+
+/*
+ * prefetchStreamHit - On a demand miss, check the stream buffer heads.
+ *     Returns 1 when a buffer supplies the block; the caller then fills
+ *     it into the cache.
+ */
+int prefetchStreamHit(Prefetcher_t* pf, long set, long tag, long now);
+
+/*
+ * prefetchTrain - Train on a demand access once it has been resolved
+ *     and issue the resulting prefetches into the cache
+ */
+void prefetchTrain(Prefetcher_t* pf, unsigned long address, int miss,
+        long now);
+
+#endif /* PREFETCH_H */
@@ -0,0 +1,276 @@
+/*
+ * reuse.c - Reuse distance and working set analysis of a trace
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "reuse.h"
+
+/* Initial size of the block table, a power of two, and fewest times */
+#define INITIAL_TABLE (1L << 16)
+#define MIN_TIMES (1L << 12)
+
+static void accessOne(Reuse_t* r, unsigned long address);
+static long hashSlot(Reuse_t* r, long block);
+static long findSlot(Reuse_t* r, long block);
+static void growTable(Reuse_t* r);
+static void allocTimes(Reuse_t* r, long capacity);
+static void renumber(Reuse_t* r);
+static void liveMove(Reuse_t* r, long from, long to);
+static long liveBefore(Reuse_t* r, long time);
+static void endWindow(Reuse_t* r);
+static void outOfMemory(Reuse_t* r);
+
+Reuse_t* reuseCreate(int b, long window, FILE* wss) {
+    Reuse_t* r = calloc(1, sizeof(Reuse_t));
+    if (r == NULL) {
+        return NULL;
+    }
+    r->b = b;
+    r->wss = wss;
+    r->window = window;
+    r->table_size = INITIAL_TABLE;
+    r->table = malloc(r->table_size * sizeof(struct ReuseBlock));
+    if (r->table == NULL) {
+        reuseFree(r);
+        return NULL;
+    }
+    for (long i = 0; i < r->table_size; i++) {
+        r->table[i].block = -1;
+    }
+    allocTimes(r, MIN_TIMES);
+    fprintf(wss, "first_access,last_access,distinct_blocks,bytes\n");
+    return r;
+}
+
+void reuseFree(Reuse_t* r) {
+    free(r->table);
+    free(r->live);
+    free(r->tree);
+    free(r->owner);
+    free(r);
+}
+
+void reuseAccess(Reuse_t* r, const unsigned long addresses[], int count) {
+    for (int i = 0; i < count; i++) {
+        __builtin_prefetch(&r->table[hashSlot(r, addresses[i] >> r->b)]);
+    }
+    for (int i = 0; i < count; i++) {
+        accessOne(r, addresses[i]);
+    }
+}
+
+static void accessOne(Reuse_t* r, unsigned long address) {
+    long block = address >> r->b;
+    if (r->now == r->capacity) {
+        renumber(r);
+    }
+    if (r->blocks * 2 >= r->table_size) {
+        growTable(r);
+    }
+
+    long slot = findSlot(r, block);
+    struct ReuseBlock* e = &r->table[slot];
+    if (e->block < 0) {
+        e->block = block;
+        r->blocks++;
+        r->cold++;
+        r->window_blocks++;
+        liveMove(r, -1, r->now);
+    } else {
+        // every block accessed since has its latest access after ours
+        long distance = r->blocks - 1 - liveBefore(r, e->time);
+        int bucket = distance ? 64 - __builtin_clzl(distance) : 0;
+        r->buckets[bucket]++;
+        if (e->time < r->window_time) {
+            r->window_blocks++;
+        }
+        liveMove(r, e->time, r->now);
+    }
+    e->time = r->now;
+    r->owner[r->now] = slot;
+    r->now++;
+    r->accesses++;
+
+    if (r->accesses - r->window_start == r->window) {
+        endWindow(r);
+    }
+}
+
+void reuseFinish(Reuse_t* r) {
+    if (r->accesses > r->window_start) {
+        endWindow(r);
+    }
+}
+
+void reuseWriteHistogram(Reuse_t* r, FILE* out) {
+    int last = 0;
+    for (int k = 0; k < REUSE_BUCKETS; k++) {
+        if (r->buckets[k]) {
+            last = k;
+        }
+    }
+    // lru_hit_fraction: hits of a fully associative LRU cache holding
+    // max_distance + 1 blocks
+    fprintf(out, "min_distance,max_distance,accesses,lru_hit_fraction\n");
+    long hits = 0;
+    for (int k = 0; k <= last; k++) {
+        long lo = k ? 1L << (k - 1) : 0;
+        long hi = k ? (1L << k) - 1 : 0;
+        hits += r->buckets[k];
+        fprintf(out, "%ld,%ld,%ld,%.6f\n", lo, hi, r->buckets[k],
+                r->accesses ? (double) hits / r->accesses : 0.0);
+    }
+    fprintf(out, "cold,cold,%ld,\n", r->cold);
+}
+
+/* First slot probed for block */
+static long hashSlot(Reuse_t* r, long block) {
+    return (long) (((unsigned long) block * 0x9E3779B97F4A7C15UL) >> 32)
+            & (r->table_size - 1);
+}
+
+/* Slot of block in the table, or the empty slot where it belongs */
+static long findSlot(Reuse_t* r, long block) {
+    long mask = r->table_size - 1;
+    long slot = hashSlot(r, block);
+    while (r->table[slot].block >= 0 && r->table[slot].block != block) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* Double the block table, pointing the owners of times at the new slots */
+static void growTable(Reuse_t* r) {
+    long old_size = r->table_size;
+    struct ReuseBlock* old = r->table;
+    r->table_size *= 2;
+    r->table = malloc(r->table_size * sizeof(struct ReuseBlock));
+    if (r->table == NULL) {
+        outOfMemory(r);
+    }
+    for (long i = 0; i < r->table_size; i++) {
+        r->table[i].block = -1;
+    }
+    for (long i = 0; i < old_size; i++) {
+        if (old[i].block >= 0) {
+            long slot = findSlot(r, old[i].block);
+            r->table[slot] = old[i];
+            r->owner[old[i].time] = slot;
+        }
+    }
+    free(old);
+}
+
+/* (Re)allocate an empty bitmap and tree for capacity times */
+static void allocTimes(Reuse_t* r, long capacity) {
+    long words = capacity / 64;
+    r->capacity = capacity;
+    free(r->live);
+    free(r->tree);
+    r->live = calloc(words, sizeof(unsigned long));
+    r->tree = calloc(words + 1, sizeof(int));
+    long* owner = realloc(r->owner, capacity * sizeof(long));
+    if (r->live == NULL || r->tree == NULL || owner == NULL) {
+        outOfMemory(r);
+    }
+    r->owner = owner;
+}
+
+/*
+ * renumber - Give the latest accesses times 0..blocks-1, in order, by
+ *     walking the set bits, and rebuild the bitmap and tree for twice
+ *     that many times
+ */
+static void renumber(Reuse_t* r) {
+    long n = 0;
+    long window_time = 0;
+    for (long w = 0; w < r->capacity / 64; w++) {
+        for (unsigned long bits = r->live[w]; bits; bits &= bits - 1) {
+            long t = w * 64 + __builtin_ctzl(bits);
+            if (t < r->window_time) {
+                window_time++;
+            }
+            r->table[r->owner[t]].time = n;
+            r->owner[n++] = r->owner[t];
+        }
+    }
+
+    long capacity = (n * 2 + 63) / 64 * 64;
+    allocTimes(r, capacity > MIN_TIMES ? capacity : MIN_TIMES);
+    long words = r->capacity / 64;
+    for (long w = 0; w < n / 64; w++) {
+        r->live[w] = ~0UL;
+    }
+    if (n % 64) {
+        r->live[n / 64] = (1UL << (n % 64)) - 1;
+    }
+    // linear time build over the word counts
+    for (long i = 1; i <= words; i++) {
+        r->tree[i] += __builtin_popcountl(r->live[i - 1]);
+        long parent = i + (i & -i);
+        if (parent <= words) {
+            r->tree[parent] += r->tree[i];
+        }
+    }
+    r->now = n;
+    r->window_time = window_time;
+}
+
+/*
+ * liveMove - Move a block's latest access from time from (-1 for a new
+ *     block) to the later time to. Word counts only change when the
+ *     words differ; then both update paths climb the tree and meet at a
+ *     common ancestor, above which the -1 and +1 cancel, so they are
+ *     walked together and stop there.
+ */
+static void liveMove(Reuse_t* r, long from, long to) {
+    long words = r->capacity / 64;
+    r->live[to / 64] |= 1UL << (to % 64);
+    long j = to / 64 + 1;
+    if (from < 0) {
+        for (; j <= words; j += j & -j) {
+            r->tree[j]++;
+        }
+        return;
+    }
+    r->live[from / 64] &= ~(1UL << (from % 64));
+    long i = from / 64 + 1;
+    while (i != j) {
+        if (i < j) {
+            if (i > words) {
+                break;
+            }
+            r->tree[i]--;
+            i += i & -i;
+        } else {
+            if (j > words) {
+                break;
+            }
+            r->tree[j]++;
+            j += j & -j;
+        }
+    }
+}
+
+/* Number of latest access times before time */
+static long liveBefore(Reuse_t* r, long time) {
+    long w = time / 64;
+    long sum = __builtin_popcountl(r->live[w] & ((1UL << (time % 64)) - 1));
+    for (long i = w; i > 0; i -= i & -i) {
+        sum += r->tree[i];
+    }
+    return sum;
+}
+
+static void endWindow(Reuse_t* r) {
+    fprintf(r->wss, "%ld,%ld,%ld,%ld\n", r->window_start, r->accesses - 1,
+            r->window_blocks, r->window_blocks << r->b);
+    r->window_start = r->accesses;
+    r->window_time = r->now;
+    r->window_blocks = 0;
+}
+
+static void outOfMemory(Reuse_t* r) {
+    fprintf(stderr, "Out of memory for %ld blocks\n", r->blocks);
+    exit(1);
+}
@@ -0,0 +1,87 @@
+/*
+ * reuse.h - Reuse distance and working set analysis of a trace
+ *
+ * The reuse (LRU stack) distance of an access is the number of distinct
+ * blocks referenced since the previous access to the same block. An
+ * access hits in a fully associative LRU cache of C blocks exactly when
+ * its distance is below C, so a single histogram gives the hit ratio of
+ * every cache size.
+ *
+ * Distances come from the set of latest access times, one per block:
+ * the distance is the number of those after the block's previous
+ * access. The set is a bitmap over times with a Fenwick tree over the
+ * bit count of each 64-bit word, so a count is a walk of a tree 64 times
+ * smaller than the times plus a popcount, O(log n) per access with the
+ * hot data in cache. The times span about twice the live blocks: when
+ * they run out, the set bits are renumbered 0..blocks-1 and the bitmap
+ * rebuilt at twice the block count, amortizing the renumbering over as
+ * many accesses.
+ *
+ * The working set curve counts the distinct blocks touched in each
+ * window of consecutive accesses.
+ */
+
+#ifndef REUSE_H
+#define REUSE_H
+
+#include <stdio.h>
+
+/* Histogram buckets: 0 holds distance 0, k holds [2^(k-1), 2^k) */
+#define REUSE_BUCKETS 64
+
+/* A block's entry in the table */
+struct ReuseBlock {
+    long block;             /* block number, -1 when empty */
+    long time;              /* time of its latest access */
+};
+
+struct Reuse {
+    int b;
+
+    /* block number -> latest access, in an open addressing table */
+    struct ReuseBlock* table;
+    long table_size;
+    long blocks;
+
+    /* latest access times, with a Fenwick tree over each word's count */
+    unsigned long* live;
+    int* tree;
+    long* owner;            /* table slot that accessed each time */
+    long capacity;          /* times, a multiple of 64 */
+    long now;
+
+    long accesses;
+    long cold;
+    long buckets[REUSE_BUCKETS];
+
+    /* working set curve */
+    FILE* wss;
+    long window;
+    long window_start;      /* first access of the window */
+    long window_time;       /* and its time */
+    long window_blocks;
+};
+typedef struct Reuse Reuse_t;
+
+/*
+ * reuseCreate - Analyse blocks of 2^b bytes, writing the distinct block
+ *     count of every window accesses to wss as CSV. Returns NULL when
+ *     out of memory.
+ */
+Reuse_t* reuseCreate(int b, long window, FILE* wss);
+void reuseFree(Reuse_t* r);
+
+/*
+ * reuseAccess - Account a batch of accesses in order. The table slots
+ *     of the whole batch are prefetched first, so their cache misses
+ *     overlap.
+ */
+void reuseAccess(Reuse_t* r, const unsigned long addresses[], int count);
+
+/* Write the last, partial working set window */
+void reuseFinish(Reuse_t* r);
+
+/* Write the reuse distance histogram as CSV */
+void reuseWriteHistogram(Reuse_t* r, FILE* out);
+
+#endif /* REUSE_H */
@@ -2,7 +2,12 @@
  * test-trans.c - Checks the correctness and performance of all of the
  *     student's transpose functions and records the results for their
  *     official submitted version as well.
+ *
+ *     With -S <size> it checks the sized transposes of trans-sized.c
+ *     for that element size instead, and with -B <runs> it also times
+ *     the functions natively.
  */
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -14,6 +19,8 @@
 #include "cachelab.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
+#include <time.h>
+#include "perfcount.h"
 
 /* Maximum array dimension */
 #define MAXN 256
@@ -25,13 +32,31 @@
 /* External function defined in trans.c */
 extern void registerFunctions();
 
+/* External function defined in trans-sized.c */
+extern void registerSizedFunctions();
+
 /* External variables defined in cachelab-tools.c */
 extern trans_func_t func_list[MAX_TRANS_FUNCS];
 extern int func_counter; 
+extern sized_trans_func_t sized_func_list[MAX_TRANS_FUNCS];
+extern int sized_func_counter;
 
 /* Globals set on the command line */
 static int M = 0;
 static int N = 0;
+static int elem_size = 0;   /* -S: element size of the sized transposes */
+
+/* Native benchmark (-B): runs per function on warm and on cold buffers */
+#ifndef BENCH_OPT
+#define BENCH_OPT "unknown flags" /* set by the Makefile */
+#endif
+static int bench_runs = 0;
+
+/* Bytes written between cold runs to evict the host caches and TLB */
+#define FLUSH_BYTES (64 << 20)
+
+/* Bytes per matrix element of the functions under test */
+#define ELEM_BYTES (elem_size ? elem_size : (int) sizeof(int))
 
 /* The correctness and performance for the submitted transpose function */
 struct results {
@@ -41,6 +66,229 @@ struct results {
 };
 static struct results results = {-1, 0, INT_MAX};
 
+/* Maximum number of layouts and set hashes explored with -L and -H */
+#define MAX_LAYOUTS 16
+#define MAX_HASHES 3
+
+/* A layout moves A and B by a byte offset from where tracegen put
+   them and pads each of their rows by some elements */
+struct layout {
+    long offset_a;
+    long offset_b;
+    int pad;
+};
+static struct layout layouts[MAX_LAYOUTS];
+static int layout_count = 0;
+
+/* Set index hashes passed to csim -H for every layout */
+static char* hashes[MAX_HASHES];
+static int hash_count = 0;
+
+/* Misses of each function under each layout and hash, or one of these
+   markers when the layout makes A and B overlap or csim failed */
+#define LAYOUT_OVERLAP UINT_MAX
+#define LAYOUT_FAILED (UINT_MAX - 1)
+static unsigned int layout_misses[MAX_TRANS_FUNCS][MAX_LAYOUTS][MAX_HASHES];
+
+/*
+ * The functions under test are the int transposes, or with -S the sized
+ * transposes. These helpers hide which list is in use.
+ */
+int func_total()
+{
+    return elem_size ? sized_func_counter : func_counter;
+}
+
+char* func_description(int i)
+{
+    return elem_size ? sized_func_list[i].description : func_list[i].description;
+}
+
+/* Whether function i is left out: a sized transpose of another size */
+int func_skipped(int i)
+{
+    return elem_size && sized_func_list[i].elem_size != elem_size;
+}
+
+int func_correct(int i)
+{
+    return elem_size ? sized_func_list[i].correct : func_list[i].correct;
+}
+
+void func_record(int i, unsigned int hits, unsigned int misses,
+                 unsigned int evictions)
+{
+    if (elem_size) {
+        sized_func_list[i].correct = 1;
+        sized_func_list[i].num_hits = hits;
+        sized_func_list[i].num_misses = misses;
+        sized_func_list[i].num_evictions = evictions;
+    } else {
+        func_list[i].correct = 1;
+        func_list[i].num_hits = hits;
+        func_list[i].num_misses = misses;
+        func_list[i].num_evictions = evictions;
+    }
+}
+
+/*
+ * remap_address - Move an address inside A or B to where the layout puts
+ *     it. A has N rows of M elements and B has M rows of N elements.
+ */
+unsigned long long int remap_address(unsigned long long int addr,
+                                     struct layout* l,
+                                     unsigned long long int base_a,
+                                     unsigned long long int base_b)
+{
+    unsigned long long int base, row, col;
+    long offset;
+    int cols;
+
+    if (addr >= base_a && addr < base_a + (unsigned long long) N*M*ELEM_BYTES) {
+        base = base_a;
+        offset = l->offset_a;
+        cols = M;
+    } else if (addr >= base_b && addr < base_b + (unsigned long long) M*N*ELEM_BYTES) {
+        base = base_b;
+        offset = l->offset_b;
+        cols = N;
+    } else {
+        return addr;
+    }
+    row = (addr - base) / ELEM_BYTES / cols;
+    col = (addr - base) / ELEM_BYTES % cols;
+    return base + offset + (row * (cols + l->pad) + col) * ELEM_BYTES
+        + (addr - base) % ELEM_BYTES;
+}
+
+/*
+ * eval_layouts - Replay the trace of function i with A and B moved and
+ *     padded by each layout, under each set index hash, with csim
+ */
+void eval_layouts(int i, unsigned int s, unsigned int E, unsigned int b,
+                  unsigned long long int base_a, unsigned long long int base_b)
+{
+    int l, h;
+    unsigned int len, hits, misses, evictions;
+    unsigned long long int addr;
+    char buf[1000], cmd[255], filename[128];
+
+    printf("Step 3: Evaluating %d layouts\n", layout_count);
+    sprintf(filename, "trace.f%d", i);
+    for (l = 0; l < layout_count; l++) {
+        struct layout* lay = &layouts[l];
+
+        /* Skip layouts where the moved matrices overlap */
+        long long start_a = base_a + lay->offset_a;
+        long long end_a = start_a + (long long) N*(M+lay->pad)*ELEM_BYTES;
+        long long start_b = base_b + lay->offset_b;
+        long long end_b = start_b + (long long) M*(N+lay->pad)*ELEM_BYTES;
+        if (start_a < end_b && start_b < end_a) {
+            for (h = 0; h < hash_count; h++)
+                layout_misses[i][l][h] = LAYOUT_OVERLAP;
+            continue;
+        }
+
+        FILE* in_fp = fopen(filename, "r");
+        FILE* out_fp = fopen("trace.layout", "w");
+        assert(in_fp && out_fp);
+        while (fgets(buf, 1000, in_fp) != NULL) {
+            sscanf(buf+3, "%llx,%u", &addr, &len);
+            fprintf(out_fp, " %c %llx,%u\n", buf[1],
+                    remap_address(addr, lay, base_a, base_b), len);
+        }
+        fclose(in_fp);
+        fclose(out_fp);
+
+        for (h = 0; h < hash_count; h++) {
+            sprintf(cmd, "./csim -s %u -E %u -b %u -H %s -t trace.layout > /dev/null",
+                    s, E, b, hashes[h]);
+            /* Never read a previous run's results when csim fails */
+            unlink(".csim_results");
+            int status = system(cmd);
+            FILE* res_fp = fopen(".csim_results","r");
+            if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) ||
+                !res_fp ||
+                fscanf(res_fp, "%u %u %u", &hits, &misses, &evictions) != 3) {
+                layout_misses[i][l][h] = LAYOUT_FAILED;
+            } else {
+                layout_misses[i][l][h] = misses;
+            }
+            if (res_fp)
+                fclose(res_fp);
+        }
+    }
+}
+
+/*
+ * print_layouts - Print the misses of every function under each layout
+ */
+void print_layouts(unsigned int s, unsigned int E, unsigned int b)
+{
+    int i, l, h;
+
+    /* Replays run through ./csim -H, not csim-ref, so even the bits
+       column may differ from the graded count */
+    printf("\nLayouts (s=%u, E=%u, b=%u): misses per function, "
+           "replayed with ./csim (not csim-ref)\n", s, E, b);
+    printf("func  A offset  B offset  pad");
+    for (h = 0; h < hash_count; h++)
+        printf(" %9s", hashes[h]);
+    printf("\n");
+    for (i = 0; i < func_total(); i++) {
+        if (func_skipped(i) || !func_correct(i) ||
+            (elem_size && sized_func_list[i].in_place))
+            continue;
+        for (l = 0; l < layout_count; l++) {
+            printf("%4d  %8ld  %8ld  %3d", i, layouts[l].offset_a,
+                   layouts[l].offset_b, layouts[l].pad);
+            for (h = 0; h < hash_count; h++) {
+                if (layout_misses[i][l][h] == LAYOUT_OVERLAP)
+                    printf(" %9s", "overlap");
+                else if (layout_misses[i][l][h] == LAYOUT_FAILED)
+                    printf(" %9s", "failed");
+                else
+                    printf(" %9u", layout_misses[i][l][h]);
+            }
+            printf("\n");
+        }
+    }
+}
+
+/*
+ * parse_layouts - Parse a comma separated list of offset_a:offset_b:pad
+ *     layouts. Returns 0 on error.
+ */
+int parse_layouts(char* arg)
+{
+    char* item;
+    for (item = strtok(arg, ","); item; item = strtok(NULL, ",")) {
+        struct layout* l = &layouts[layout_count];
+        if (layout_count == MAX_LAYOUTS ||
+            sscanf(item, "%ld:%ld:%d", &l->offset_a, &l->offset_b, &l->pad) != 3 ||
+            l->offset_a % sizeof(int) || l->offset_b % sizeof(int) || l->pad < 0)
+            return 0;
+        layout_count++;
+    }
+    return layout_count > 0;
+}
+
+/*
+ * parse_hashes - Parse a comma separated list of csim set index hashes.
+ *     Returns 0 on error.
+ */
+int parse_hashes(char* arg)
+{
+    char* item;
+    for (item = strtok(arg, ","); item; item = strtok(NULL, ",")) {
+        if (hash_count == MAX_HASHES ||
+            (strcmp(item, "bits") && strcmp(item, "xor") && strcmp(item, "prime")))
+            return 0;
+        hashes[hash_count++] = item;
+    }
+    return hash_count > 0;
+}
+
 /* 
  * eval_perf - Evaluate the performance of the registered transpose functions
  */
@@ -49,10 +297,17 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
     int i,flag;
     unsigned int len, hits, misses, evictions;
     unsigned long long int marker_start, marker_end, addr;
+    unsigned long long int base_a, base_b;
     char buf[1000], cmd[255];
     char filename[128];
 
     registerFunctions(); 
+    registerSizedFunctions();
+
+    /* Pass -S on to tracegen */
+    char sized_arg[16] = "";
+    if (elem_size)
+        sprintf(sized_arg, " -S %d", elem_size);
 
     /* Open the complete trace file */
     FILE* full_trace_fp;  
@@ -60,30 +315,31 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
 
     /* Evaluate the performance of each registered transpose function */
 
-    for (i=0; i<func_counter; i++) {
-        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
+    for (i=0; i<func_total(); i++) {
+        if (func_skipped(i))
+            continue;
+        if (!elem_size && strcmp(func_description(i), SUBMIT_DESCRIPTION) == 0 )
             results.funcid = i; /* remember which function is the submission */
 
 
-        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
+        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_total());
         /* Use valgrind to generate the trace */
 
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N,i);
+        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d%s  > trace.tmp", M, N,i,sized_arg);
         flag=WEXITSTATUS(system(cmd));
         if (0!=flag) {
-            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
+            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d%s for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i,sized_arg);      
             continue;
         }
 
         /* Get the start and end marker addresses */
         FILE* marker_fp = fopen(".marker", "r");
         assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
+        fscanf(marker_fp, "%llx %llx %llx %llx", &marker_start, &marker_end,
+               &base_a, &base_b);
         fclose(marker_fp);
 
 
-        func_list[i].correct=1;
-
         /* Save the correctness of the transpose submission */
         if (results.funcid == i ) {
             results.correct = 1;
@@ -146,30 +402,170 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
         assert(in_fp);
         fscanf(in_fp, "%u %u %u", &hits, &misses, &evictions);
         fclose(in_fp);
-        func_list[i].num_hits = hits;
-        func_list[i].num_misses = misses;
-        func_list[i].num_evictions = evictions;
+        func_record(i, hits, misses, evictions);
         printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
-               i, func_list[i].description, hits, misses, evictions);
+               i, func_description(i), hits, misses, evictions);
     
         /* If it is transpose_submit(), record number of misses */
         if (results.funcid == i) {
             results.misses = misses;
         }
+
+        /* An in-place transpose has no separate B to move */
+        if (layout_count > 0 && !(elem_size && sized_func_list[i].in_place))
+            eval_layouts(i, s, E, b, base_a, base_b);
     }
   
+    if (layout_count > 0)
+        print_layouts(s, E, b);
+}
+
+/*
+ * call_func - Run function i once natively; in-place sized functions
+ *     get B == A
+ */
+void call_func(int i, void* a, void* b)
+{
+    if (elem_size) {
+        sized_trans_func_t* f = &sized_func_list[i];
+        (*f->func_ptr)(M, N, a, f->in_place ? a : b);
+    } else {
+        (*func_list[i].func_ptr)(M, N, a, b);
+    }
+}
+
+/* Seconds on the monotonic clock */
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Print a per-call count, or n/a for an unavailable counter */
+void print_count(long long count, int runs)
+{
+    if (count < 0)
+        printf(" %10s", "n/a");
+    else
+        printf(" %10.1f", (double) count / runs);
+}
+
+/*
+ * bench_perf - Time every function natively, bench_runs times on warm
+ *     buffers and bench_runs times right after evicting them, and print
+ *     per-call time, bandwidth and hardware misses next to the misses
+ *     csim simulated
+ */
+void bench_perf()
+{
+    int i, r;
+    long bytes = (long) M * N * ELEM_BYTES;
+    unsigned char *orig, *expected, *a, *b, *flush;
+    long long counts[PERF_EVENTS];
+    perf_counters_t pc;
+
+    if (posix_memalign((void**) &orig, 4096, bytes) ||
+        posix_memalign((void**) &expected, 4096, bytes) ||
+        posix_memalign((void**) &a, 4096, bytes) ||
+        posix_memalign((void**) &b, 4096, bytes) ||
+        (flush = malloc(FLUSH_BYTES)) == NULL) {
+        printf("Error: Unable to allocate benchmark buffers\n");
+        return;
+    }
+    if (elem_size) {
+        initSizedMatrix(M, N, elem_size, orig);
+        correctSizedTrans(M, N, elem_size, orig, expected);
+    } else {
+        initMatrix(M, N, (void*) orig, (void*) b);
+        correctTrans(M, N, (void*) orig, (void*) expected);
+    }
+    perfOpen(&pc);
+
+    printf("\nNative benchmark (%dx%d, %d-byte elements, %d runs per state, per call,\n"
+           "transposes built with %s; sim misses are from their -O0 traces)\n",
+           M, N, ELEM_BYTES, bench_runs, BENCH_OPT);
+    printf("func  state    ns/elem       GB/s sim misses   L1D miss   LLC miss  dTLB miss\n");
+    for (i = 0; i < func_total(); i++) {
+        if (func_skipped(i))
+            continue;
+        int in_place = elem_size && sized_func_list[i].in_place;
+        alarm(120);
+
+        /* One untimed call warms the buffers and checks the result */
+        memcpy(a, orig, bytes);
+        call_func(i, a, b);
+        int correct = memcmp(in_place ? a : b, expected, bytes) == 0;
+
+        for (int cold = 0; cold <= 1; cold++) {
+            double seconds = 0, start;
+            perfReset(&pc);
+            if (!cold) {
+                perfStart(&pc);
+                start = now();
+                for (r = 0; r < bench_runs; r++)
+                    call_func(i, a, b);
+                seconds = now() - start;
+                perfStop(&pc);
+            } else {
+                for (r = 0; r < bench_runs; r++) {
+                    memset(flush, r, FLUSH_BYTES);
+                    perfStart(&pc);
+                    start = now();
+                    call_func(i, a, b);
+                    seconds += now() - start;
+                    perfStop(&pc);
+                }
+            }
+            perfRead(&pc, counts);
+
+            double per_call = seconds / bench_runs;
+            printf("%4d  %-5s %10.3f %10.3f", i, cold ? "cold" : "warm",
+                   per_call * 1e9 / ((double) M * N),
+                   2.0 * bytes / per_call / 1e9);
+            if (func_correct(i))
+                printf(" %10u", elem_size ? sized_func_list[i].num_misses
+                                          : func_list[i].num_misses);
+            else
+                printf(" %10s", "-");
+            print_count(counts[PERF_L1D_MISS], bench_runs);
+            print_count(counts[PERF_LLC_MISS], bench_runs);
+            print_count(counts[PERF_DTLB_MISS], bench_runs);
+            printf("%s\n", correct ? "" : "  (wrong result)");
+        }
+    }
+    printf("GB/s counts the bytes of A read plus the bytes of B written; sim\n");
+    printf("misses are from the simulated cache above, \"-\" when not simulated.\n");
+
+    perfClose(&pc);
+    free(orig);
+    free(expected);
+    free(a);
+    free(b);
+    free(flush);
 }
 
 /*
  * usage - Print usage info
  */
 void usage(char *argv[]){
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-h] -M <rows> -N <cols> [-S <size>] [-B <runs>] [-L <layouts> [-H <hashes>]]\n", argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
     printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
     printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
+    printf("  -S <size>   Check the sized transposes of 1, 2, 4, 8 or 16-byte elements\n");
+    printf("  -B <runs>   Also time each function natively, <runs> calls on warm and\n");
+    printf("              on cold buffers, with hardware miss counters if available\n");
+    printf("  -L <list>   Also replay each function with A and B moved and padded,\n");
+    printf("              a comma separated list of a_offset:b_offset:pad layouts\n");
+    printf("              (byte offsets, pad in elements per row, max %d)\n", MAX_LAYOUTS);
+    printf("  -H <list>   csim set index hashes for -L: bits, xor, prime\n");
+    printf("              (default all three)\n");
     printf("Example: %s -M 8 -N 8\n", argv[0]);       
+    printf("Example: %s -M 61 -N 67 -S 8\n", argv[0]);
+    printf("Example: %s -M 64 -N 64 -B 100\n", argv[0]);
+    printf("Example: %s -M 64 -N 64 -L 0:0:0,0:32:0,0:0:8\n", argv[0]);
 }
 
 /*
@@ -199,7 +595,7 @@ int main(int argc, char* argv[])
 {
     char c;
 
-    while ((c = getopt(argc,argv,"M:N:h")) != -1) {
+    while ((c = getopt(argc,argv,"M:N:S:B:L:H:h")) != -1) {
         switch(c) {
         case 'M':
             M = atoi(optarg);
@@ -207,6 +603,37 @@ int main(int argc, char* argv[])
         case 'N':
             N = atoi(optarg);
             break;
+        case 'S':
+            elem_size = atoi(optarg);
+            if (elem_size != 1 && elem_size != 2 && elem_size != 4 &&
+                elem_size != 8 && elem_size != 16) {
+                printf("Error: Element size must be 1, 2, 4, 8 or 16\n");
+                usage(argv);
+                exit(1);
+            }
+            break;
+        case 'B':
+            bench_runs = atoi(optarg);
+            if (bench_runs < 1) {
+                printf("Error: -B needs at least one run\n");
+                usage(argv);
+                exit(1);
+            }
+            break;
+        case 'L':
+            if (!parse_layouts(optarg)) {
+                printf("Error: Invalid layout list\n");
+                usage(argv);
+                exit(1);
+            }
+            break;
+        case 'H':
+            if (!parse_hashes(optarg)) {
+                printf("Error: Invalid hash list\n");
+                usage(argv);
+                exit(1);
+            }
+            break;
         case 'h':
             usage(argv);
             exit(0);
@@ -239,11 +666,34 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
-    /* Time out and give up after a while */
-    alarm(120);
+    if (layout_count > 0 && hash_count == 0) {
+        hashes[0] = "bits";
+        hashes[1] = "xor";
+        hashes[2] = "prime";
+        hash_count = 3;
+    }
+
+    /* Time out and give up after a while, allowing more for layouts */
+    alarm(120 + 30 * layout_count);
 
     /* Check the performance of the student's transpose function */
     eval_perf(5, 1, 5);
+
+    if (bench_runs > 0)
+        bench_perf();
+
+    /* The sized transposes have no submission, summarize them all */
+    if (elem_size) {
+        printf("\nSummary for %d-byte elements:\n", elem_size);
+        for (int i = 0; i < sized_func_counter; i++) {
+            if (func_skipped(i))
+                continue;
+            printf("func %d (%s): correctness=%d misses=%u\n", i,
+                   sized_func_list[i].description, sized_func_list[i].correct,
+                   sized_func_list[i].num_misses);
+        }
+        return 0;
+    }
   
     /* Emit the results for this particular test */
     if (results.funcid == -1) {
@@ -0,0 +1,129 @@
+/*
+ * tlb.c - TLB and page walk model for the cache simulator
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tlb.h"
+
+/* Names of the levels in the summary */
+static const char* levelNames[MAX_TLB_LEVELS] = {"dtlb", "stlb", "l3tlb"};
+
+Tlb_t* tlbCreate(const char* spec, const char* page) {
+    Tlb_t* tlb = calloc(1, sizeof(Tlb_t));
+    if (tlb == NULL) {
+        return NULL;
+    }
+
+    if (strcmp(page, "4K") == 0 || strcmp(page, "4k") == 0) {
+        tlb->page_bits = 12;
+        tlb->walk_depth = 4;
+    } else if (strcmp(page, "2M") == 0 || strcmp(page, "2m") == 0) {
+        tlb->page_bits = 21;
+        tlb->walk_depth = 3;
+    } else if (strcmp(page, "1G") == 0 || strcmp(page, "1g") == 0) {
+        tlb->page_bits = 30;
+        tlb->walk_depth = 2;
+    } else {
+        free(tlb);
+        return NULL;
+    }
+
+    const char* p = spec;
+    while (*p) {
+        int entries, ways, used;
+        if (tlb->levels == MAX_TLB_LEVELS ||
+                sscanf(p, "%d:%d%n", &entries, &ways, &used) != 2 ||
+                entries < 1 || ways < 1 || entries % ways != 0) {
+            tlbFree(tlb);
+            return NULL;
+        }
+        struct TlbLevel* l = &tlb->level[tlb->levels++];
+        l->entries = entries;
+        l->ways = ways;
+        l->sets = entries / ways;
+        l->lines = malloc(entries * sizeof(Line_t));
+        if (l->lines == NULL) {
+            tlbFree(tlb);
+            return NULL;
+        }
+        initializeCache(l->lines, l->sets, ways);
+        p += used;
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            tlbFree(tlb);
+            return NULL;
+        }
+    }
+    if (tlb->levels == 0) {
+        tlbFree(tlb);
+        return NULL;
+    }
+    return tlb;
+}
+
+void tlbFree(Tlb_t* tlb) {
+    for (int i = 0; i < tlb->levels; i++) {
+        free(tlb->level[i].lines);
+    }
+    free(tlb);
+}
+
+int tlbAccess(Tlb_t* tlb, unsigned long address) {
+    long vpn = address >> tlb->page_bits;
+    tlb->accesses++;
+    tlb->clock++;
+
+    int missed = 0;
+    while (missed < tlb->levels) {
+        struct TlbLevel* l = &tlb->level[missed];
+        Line_t* set = &l->lines[(vpn % l->sets) * l->ways];
+        int line = findLine(set, l->ways, vpn / l->sets);
+        if (line >= 0) {
+            l->hits++;
+            set[line].last_used = tlb->clock;
+            break;
+        }
+        l->misses++;
+        missed++;
+    }
+    // fill the translation into every level that missed
+    for (int i = 0; i < missed; i++) {
+        struct TlbLevel* l = &tlb->level[i];
+        Line_t* set = &l->lines[(vpn % l->sets) * l->ways];
+        int line = victimLine(set, l->ways);
+        set[line].valid = 1;
+        set[line].tag = vpn / l->sets;
+        set[line].last_used = tlb->clock;
+    }
+    if (missed == tlb->levels) {
+        tlb->walks++;
+        return missed + 1;
+    }
+    return missed;
+}
+
+void tlbPrintSummary(Tlb_t* tlb) {
+    double accesses = tlb->accesses ? tlb->accesses : 1;
+    for (int i = 0; i < tlb->levels; i++) {
+        struct TlbLevel* l = &tlb->level[i];
+        printf("%s entries:%d ways:%d hits:%ld misses:%ld misses/access:%.6f\n",
+                levelNames[i], l->entries, l->ways, l->hits, l->misses,
+                l->misses / accesses);
+    }
+    printf("page walks:%ld pte_reads:%ld walks/access:%.6f\n",
+            tlb->walks, tlb->walks * tlb->walk_depth, tlb->walks / accesses);
+}
+
+void tlbPrintJson(Tlb_t* tlb, FILE* out) {
+    fprintf(out, "\"tlb\":{\"levels\":[");
+    for (int i = 0; i < tlb->levels; i++) {
+        struct TlbLevel* l = &tlb->level[i];
+        fprintf(out, "%s{\"name\":\"%s\",\"entries\":%d,\"ways\":%d,"
+                "\"hits\":%ld,\"misses\":%ld}", i ? "," : "", levelNames[i],
+                l->entries, l->ways, l->hits, l->misses);
+    }
+    fprintf(out, "],\"walks\":%ld,\"pte_reads\":%ld}", tlb->walks,
+            tlb->walks * tlb->walk_depth);
+}
@@ -0,0 +1,61 @@
+/*
+ * tlb.h - TLB and page walk model for the cache simulator
+ *
+ * Translations are looked up in up to MAX_TLB_LEVELS set-associative
+ * LRU TLBs, a first level dTLB followed by second level STLBs. A miss
+ * in one level looks up the next, and a miss in the last level walks
+ * the page table. Levels are filled on the way back, so every level
+ * holds the translation after a miss. All pages of a run have the same
+ * size; a walk reads one page table entry per radix level (4 for 4KB
+ * pages, 3 for 2MB and 2 for 1GB on x86-64).
+ */
+
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdio.h>
+#include "cache.h"
+
+#define MAX_TLB_LEVELS 3
+
+struct TlbLevel {
+    int entries;
+    int ways;
+    long sets;
+    Line_t* lines;
+    long hits;
+    long misses;
+};
+
+struct Tlb {
+    int levels;
+    int page_bits;
+    int walk_depth;         /* page table entries read per walk */
+    struct TlbLevel level[MAX_TLB_LEVELS];
+    long accesses;
+    long walks;
+    long clock;
+};
+typedef struct Tlb Tlb_t;
+
+/*
+ * tlbCreate - Build a TLB from a spec of comma separated entries:ways
+ *     levels, first level first (e.g. "64:4,1536:12"), and a page size
+ *     of 4K, 2M or 1G. Returns NULL for an invalid spec or page size.
+ */
+Tlb_t* tlbCreate(const char* spec, const char* page);
+void tlbFree(Tlb_t* tlb);
+
+/*
+ * tlbAccess - Translate the address of one trace access. Returns the
+ *     number of levels that missed; levels + 1 means a page walk.
+ */
+int tlbAccess(Tlb_t* tlb, unsigned long address);
+
+/* Print the per-level counts and the misses per access */
+void tlbPrintSummary(Tlb_t* tlb);
+
+/* Write the same counts as a "tlb" JSON member */
+void tlbPrintJson(Tlb_t* tlb, FILE* out);
+
+#endif /* TLB_H */
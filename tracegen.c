@@ -4,7 +4,12 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses are recorded in file for later use, followed by the base
+ * addresses of A and B so that test-trans can move the matrices around
+ * in the trace.
+ *
+ * With -S <size> the sized transposes of that element size are traced
+ * instead of the int ones.
  */
 
 #include <stdlib.h>
@@ -18,10 +23,15 @@
 /* External variables declared in cachelab.c */
 extern trans_func_t func_list[MAX_TRANS_FUNCS];
 extern int func_counter; 
+extern sized_trans_func_t sized_func_list[MAX_TRANS_FUNCS];
+extern int sized_func_counter;
 
 /* External function from trans.c */
 extern void registerFunctions();
 
+/* External function from trans-sized.c */
+extern void registerSizedFunctions();
+
 /* Markers used to bound trace regions of interest */
 volatile char MARKER_START, MARKER_END;
 
@@ -30,6 +40,15 @@ static int B[256][256];
 static int M;
 static int N;
 
+/* Buffers of the sized transposes: SA and SB are the matrices, SC keeps
+   the original A and SD the expected result */
+#define SIZED_BYTES (256 * 256 * MAX_ELEM_SIZE)
+static unsigned char SA[SIZED_BYTES];
+static unsigned char SB[SIZED_BYTES];
+static unsigned char SC[SIZED_BYTES];
+static unsigned char SD[SIZED_BYTES];
+static int elemSize = 0;
+
 
 int validate(int fn,int M, int N, int A[N][M], int B[M][N]) {
     int C[M][N];
@@ -46,12 +65,36 @@ int validate(int fn,int M, int N, int A[N][M], int B[M][N]) {
     return 1;
 }
 
+/* Check a sized transpose's result against correctSizedTrans */
+int validateSized(int fn, int M, int N, int size, const unsigned char* result) {
+    correctSizedTrans(M, N, size, SC, SD);
+    for (long k = 0; k < (long) M*N; k++) {
+        if (memcmp(result + k*size, SD + k*size, size)) {
+            printf("Validation failed on sized function %d! Wrong element at B[%ld][%ld]\n",
+                   fn, k / N, k % N);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Run sized function fn between the markers and validate it */
+int runSized(int fn) {
+    sized_trans_func_t* f = &sized_func_list[fn];
+    unsigned char* result = f->in_place ? SA : SB;
+    memcpy(SA, SC, (size_t) M*N*elemSize);
+    MARKER_START = 33;
+    (*f->func_ptr)(M, N, SA, result);
+    MARKER_END = 34;
+    return validateSized(fn, M, N, elemSize, result);
+}
+
 int main(int argc, char* argv[]){
     int i;
 
     char c;
     int selectedFunc=-1;
-    while( (c=getopt(argc,argv,"M:N:F:")) != -1){
+    while( (c=getopt(argc,argv,"M:N:F:S:")) != -1){
         switch(c){
         case 'M':
             M = atoi(optarg);
@@ -62,6 +105,9 @@ int main(int argc, char* argv[]){
         case 'F':
             selectedFunc = atoi(optarg);
             break;
+        case 'S':
+            elemSize = atoi(optarg);
+            break;
         case '?':
         default:
             printf("./tracegen failed to parse its options.\n");
@@ -72,6 +118,40 @@ int main(int argc, char* argv[]){
 
     /*  Register transpose functions */
     registerFunctions();
+    registerSizedFunctions();
+
+    if (elemSize && selectedFunc >= 0 &&
+        (selectedFunc >= sized_func_counter ||
+         sized_func_list[selectedFunc].elem_size != elemSize)) {
+        printf("./tracegen: sized function %d does not take %d-byte elements.\n",
+               selectedFunc, elemSize);
+        exit(1);
+    }
+
+    if (elemSize) {
+        /* Fill the sized A with data and keep a copy for validation */
+        initSizedMatrix(M, N, elemSize, SC);
+
+        FILE* marker_fp = fopen(".marker","w");
+        assert(marker_fp);
+        int in_place = selectedFunc >= 0 && sized_func_list[selectedFunc].in_place;
+        fprintf(marker_fp, "%llx %llx %llx %llx", 
+                (unsigned long long int) &MARKER_START,
+                (unsigned long long int) &MARKER_END,
+                (unsigned long long int) SA,
+                (unsigned long long int) (in_place ? SA : SB));
+        fclose(marker_fp);
+
+        if (-1==selectedFunc) {
+            for (i=0; i < sized_func_counter; i++) {
+                if (sized_func_list[i].elem_size == elemSize && !runSized(i))
+                    return i+1;
+            }
+        } else if (!runSized(selectedFunc)) {
+            return selectedFunc+1;
+        }
+        return 0;
+    }
 
     /* Fill A with data */
     initMatrix(M,N, A, B); 
@@ -79,9 +159,11 @@ int main(int argc, char* argv[]){
     /* Record marker addresses */
     FILE* marker_fp = fopen(".marker","w");
     assert(marker_fp);
-    fprintf(marker_fp, "%llx %llx", 
+    fprintf(marker_fp, "%llx %llx %llx %llx", 
             (unsigned long long int) &MARKER_START,
-            (unsigned long long int) &MARKER_END );
+            (unsigned long long int) &MARKER_END,
+            (unsigned long long int) A,
+            (unsigned long long int) B );
     fclose(marker_fp);
 
     if (-1==selectedFunc) {
@@ -0,0 +1,565 @@
+/*
+ * traceio.c - Trace file input for the cache simulator
+ *
+ * A reader owns one decoder thread. The thread pulls compressed bytes
+ * from the file, decodes them into fixed-size chunks that always end on
+ * a line boundary, and publishes the chunks through a small ring. The
+ * simulation thread walks the lines of the chunk at the head of the
+ * ring and hands the chunk back once it is consumed. Chunks of binary
+ * traces end on a record boundary instead of a line boundary.
+ *
+ * gzip is decoded with zlib. zstd and lz4 use their libraries when the
+ * Makefile finds them (HAVE_ZSTD, HAVE_LZ4), and otherwise fall back to
+ * piping the file through the zstd/lz4 command line tools.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+#include "traceio.h"
+
+/* Number of chunks in the ring and the size of each one */
+#define RING_CHUNKS 8
+#define CHUNK_BYTES (256 * 1024)
+/* Size of the compressed input buffer */
+#define IN_BYTES (64 * 1024)
+/* Longest prefix needed to recognise a format */
+#define MAGIC_BYTES 4
+
+struct Chunk {
+    char* data;     /* CHUNK_BYTES + 1 so the last line can be terminated */
+    size_t len;
+};
+typedef struct Chunk Chunk_t;
+
+struct TraceReader {
+    enum TraceCodec codec;
+    FILE* file;
+    int piped;                  /* file came from popen */
+
+    /* Bytes read while sniffing the format, replayed before the file */
+    unsigned char magic[MAGIC_BYTES];
+    size_t magic_len;
+    size_t magic_pos;
+
+    /* Compressed input staging for the library decoders */
+    unsigned char* in;
+    size_t in_len;
+    size_t in_pos;
+    int in_eof;
+    int frame_done;             /* last frame ended cleanly */
+    z_stream zs;
+#ifdef HAVE_ZSTD
+    ZSTD_DStream* zds;
+#endif
+#ifdef HAVE_LZ4
+    LZ4F_dctx* lz4;
+#endif
+
+    /* Partial line carried from one chunk into the next */
+    char* carry;
+    size_t carry_len;
+
+    /* Ring shared by the decoder and simulation threads */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    Chunk_t ring[RING_CHUNKS];
+    int head;
+    int count;
+    int eof;
+    int error;
+    int stop;
+    int sniffed;                /* first chunk checked for binary magic */
+    int binary;
+
+    /* Consumer position inside the head chunk */
+    Chunk_t* cur;
+    size_t pos;
+};
+
+static int nextChunk(TraceReader_t* r);
+static int parseLine(char* line, TraceRecord_t* rec);
+static void* decodeThread(void* arg);
+static size_t decodeSome(TraceReader_t* r, char* out, size_t cap);
+static size_t readRaw(TraceReader_t* r, void* buf, size_t n);
+static enum TraceCodec detectCodec(const unsigned char* magic, size_t len);
+#if !defined(HAVE_ZSTD) || !defined(HAVE_LZ4)
+static int openPipe(TraceReader_t* r, const char* tool, const char* path);
+#endif
+static void traceError(const char* path, const char* msg);
+
+TraceReader_t* traceOpen(const char* path) {
+    TraceReader_t* r = calloc(1, sizeof(TraceReader_t));
+    if (!r) {
+        traceError(path, "out of memory");
+        return NULL;
+    }
+    int use_stdin = strcmp(path, "-") == 0;
+    r->file = use_stdin ? stdin : fopen(path, "rb");
+    if (!r->file) {
+        traceError(path, "unable to open trace file");
+        free(r);
+        return NULL;
+    }
+
+    // Sniff the magic bytes; they are replayed by readRaw
+    r->magic_len = fread(r->magic, 1, MAGIC_BYTES, r->file);
+    r->codec = detectCodec(r->magic, r->magic_len);
+
+    int ok = 1;
+    switch (r->codec)
+    {
+    case CODEC_PLAIN:
+        break;
+    case CODEC_GZIP:
+        // 15+32 lets zlib parse the gzip header itself
+        ok = inflateInit2(&r->zs, 15 + 32) == Z_OK;
+        break;
+    case CODEC_ZSTD:
+#ifdef HAVE_ZSTD
+        r->zds = ZSTD_createDStream();
+        ok = r->zds && !ZSTD_isError(ZSTD_initDStream(r->zds));
+#else
+        ok = !use_stdin && openPipe(r, "zstd", path);
+#endif
+        break;
+    case CODEC_LZ4:
+#ifdef HAVE_LZ4
+        ok = !LZ4F_isError(LZ4F_createDecompressionContext(&r->lz4,
+                    LZ4F_VERSION));
+#else
+        ok = !use_stdin && openPipe(r, "lz4", path);
+#endif
+        break;
+    }
+    if (!ok) {
+        traceError(path, "unable to start decoder for compressed trace");
+        if (r->file && r->file != stdin) {
+            if (r->piped) {
+                pclose(r->file);
+            } else {
+                fclose(r->file);
+            }
+        }
+        free(r);
+        return NULL;
+    }
+
+    r->in = malloc(IN_BYTES);
+    r->carry = malloc(CHUNK_BYTES);
+    for (int i = 0; i < RING_CHUNKS; i++) {
+        r->ring[i].data = malloc(CHUNK_BYTES + 1);
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->not_empty, NULL);
+    pthread_cond_init(&r->not_full, NULL);
+    if (pthread_create(&r->thread, NULL, decodeThread, r) != 0) {
+        traceError(path, "unable to start decoder thread");
+        r->error = 1;
+        r->eof = 1;
+        r->thread = pthread_self();
+    }
+    return r;
+}
+
+char* traceNextLine(TraceReader_t* r) {
+    if (!nextChunk(r)) {
+        return NULL;
+    }
+    char* line = r->cur->data + r->pos;
+    char* nl = memchr(line, '\n', r->cur->len - r->pos);
+    if (nl) {
+        *nl = 0;
+        r->pos = nl - r->cur->data + 1;
+    } else {
+        // final line without a newline; data has room for the terminator
+        r->cur->data[r->cur->len] = 0;
+        r->pos = r->cur->len;
+    }
+    return line;
+}
+
+int traceNext(TraceReader_t* r, TraceRecord_t* rec) {
+    for (;;) {
+        if (!nextChunk(r)) {
+            return 0;
+        }
+        if (r->binary) {
+            unsigned long long word;
+            memcpy(&word, r->cur->data + r->pos, sizeof(word));
+            r->pos += sizeof(word);
+            int op = (word >> 56) & 0xf;
+            if (op == TRACE_OP_INSTR) {
+                continue;
+            }
+            rec->op = op == TRACE_OP_LOAD ? 'L' :
+                op == TRACE_OP_STORE ? 'S' : 'M';
+            rec->size = (word >> 48) & 0xff;
+            rec->cpu = word >> 60;
+            rec->address = word & TRACE_ADDR_MASK;
+            rec->text = NULL;
+            return 1;
+        }
+        char* line = traceNextLine(r);
+        if (line && parseLine(line, rec)) {
+            return 1;
+        }
+    }
+}
+int traceClose(TraceReader_t* r) {
+    pthread_mutex_lock(&r->lock);
+    r->stop = 1;
+    pthread_cond_signal(&r->not_full);
+    pthread_mutex_unlock(&r->lock);
+    if (!pthread_equal(r->thread, pthread_self())) {
+        pthread_join(r->thread, NULL);
+    }
+
+    int error = r->error;
+    if (r->piped) {
+        // a failing decompressor shows up in its exit status
+        error |= pclose(r->file) != 0;
+    } else if (r->file != stdin) {
+        fclose(r->file);
+    }
+    if (r->codec == CODEC_GZIP) {
+        inflateEnd(&r->zs);
+    }
+#ifdef HAVE_ZSTD
+    if (r->zds) {
+        ZSTD_freeDStream(r->zds);
+    }
+#endif
+#ifdef HAVE_LZ4
+    if (r->lz4) {
+        LZ4F_freeDecompressionContext(r->lz4);
+    }
+#endif
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->not_empty);
+    pthread_cond_destroy(&r->not_full);
+    for (int i = 0; i < RING_CHUNKS; i++) {
+        free(r->ring[i].data);
+    }
+    free(r->carry);
+    free(r->in);
+    free(r);
+    return error;
+}
+
+const char* traceCodecName(TraceReader_t* r) {
+    switch (r->codec)
+    {
+    case CODEC_GZIP:
+        return "gzip";
+    case CODEC_ZSTD:
+        return "zstd";
+    case CODEC_LZ4:
+        return "lz4";
+    default:
+        return "plain";
+    }
+}
+
+int traceIsBinary(TraceReader_t* r) {
+    return r->binary;
+}
+
+/*
+ * nextChunk - Make sure the consumer has unread data in its chunk,
+ *     handing finished chunks back to the decoder. Returns 0 at end of
+ *     input.
+ */
+static int nextChunk(TraceReader_t* r) {
+    while (r->cur == NULL || r->pos >= r->cur->len) {
+        pthread_mutex_lock(&r->lock);
+        if (r->cur) {
+            // hand the consumed chunk back to the decoder
+            r->cur = NULL;
+            r->head = (r->head + 1) % RING_CHUNKS;
+            r->count--;
+            pthread_cond_signal(&r->not_full);
+        }
+        while (r->count == 0 && !r->eof) {
+            pthread_cond_wait(&r->not_empty, &r->lock);
+        }
+        if (r->count == 0) {
+            pthread_mutex_unlock(&r->lock);
+            return 0;
+        }
+        r->cur = &r->ring[r->head];
+        r->pos = 0;
+        pthread_mutex_unlock(&r->lock);
+    }
+    return 1;
+}
+
+/*
+ * parseLine - Parse a lackey data access line such as " M 20,1".
+ *     Returns 0 for instruction fetches and malformed lines.
+ */
+static int parseLine(char* line, TraceRecord_t* rec) {
+    // Ignore instruction lines, which do not start with a space
+    if (line[0] != ' ') {
+        return 0;
+    }
+    char* p = line + 1;
+    while (*p == ' ') {
+        p++;
+    }
+    char op = *p;
+    if (op != 'L' && op != 'S' && op != 'M') {
+        fprintf(stderr, "Invalid instruction found: %s\n", line);
+        return 0;
+    }
+    char* end;
+    rec->op = op;
+    rec->address = strtoul(p + 1, &end, 16);
+    rec->size = *end == ',' ? strtoul(end + 1, NULL, 10) : 0;
+    rec->cpu = 0;
+    rec->text = line + 1;
+    return 1;
+}
+
+/*
+ * decodeThread - Fill free ring slots with whole lines, or whole records
+ *     of a binary trace, until the input is exhausted or the reader is
+ *     closed.
+ */
+static void* decodeThread(void* arg) {
+    TraceReader_t* r = arg;
+    int done = 0;
+    while (!done) {
+        pthread_mutex_lock(&r->lock);
+        while (r->count == RING_CHUNKS && !r->stop) {
+            pthread_cond_wait(&r->not_full, &r->lock);
+        }
+        if (r->stop) {
+            pthread_mutex_unlock(&r->lock);
+            break;
+        }
+        Chunk_t* chunk = &r->ring[(r->head + r->count) % RING_CHUNKS];
+        pthread_mutex_unlock(&r->lock);
+
+        // Start with the partial line left over from the last chunk
+        memcpy(chunk->data, r->carry, r->carry_len);
+        size_t len = r->carry_len;
+        r->carry_len = 0;
+        while (len < CHUNK_BYTES) {
+            size_t n = decodeSome(r, chunk->data + len, CHUNK_BYTES - len);
+            if (n == 0) {
+                done = 1;
+                break;
+            }
+            len += n;
+        }
+
+        // The first chunk tells whether this is a binary trace
+        if (!r->sniffed) {
+            r->sniffed = 1;
+            if (len >= TRACE_BIN_MAGIC_LEN && memcmp(chunk->data,
+                        TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_LEN) == 0) {
+                r->binary = 1;
+                len -= TRACE_BIN_MAGIC_LEN;
+                memmove(chunk->data, chunk->data + TRACE_BIN_MAGIC_LEN, len);
+            }
+        }
+
+        // Keep the trailing partial record or line for the next chunk
+        if (r->binary) {
+            r->carry_len = len % sizeof(unsigned long long);
+            len -= r->carry_len;
+            memcpy(r->carry, chunk->data + len, r->carry_len);
+            if (done && r->carry_len) {
+                fprintf(stderr, "Binary trace ends with a partial record\n");
+                r->error = 1;
+            }
+        } else if (!done) {
+            char* last = chunk->data + len;
+            while (last > chunk->data && last[-1] != '\n') {
+                last--;
+            }
+            if (last > chunk->data) {
+                r->carry_len = chunk->data + len - last;
+                memcpy(r->carry, last, r->carry_len);
+                len = last - chunk->data;
+            }
+        }
+        chunk->len = len;
+
+        pthread_mutex_lock(&r->lock);
+        if (len > 0) {
+            r->count++;
+        }
+        r->eof = done;
+        pthread_cond_signal(&r->not_empty);
+        pthread_mutex_unlock(&r->lock);
+    }
+    return NULL;
+}
+
+/*
+ * decodeSome - Decode up to cap bytes of trace text into out. Returns 0
+ *     at end of input; decoding errors set r->error and also return 0.
+ */
+static size_t decodeSome(TraceReader_t* r, char* out, size_t cap) {
+    if (r->codec == CODEC_PLAIN || r->piped) {
+        return readRaw(r, out, cap);
+    }
+
+    size_t produced = 0;
+    while (produced == 0) {
+        if (r->in_pos == r->in_len && !r->in_eof) {
+            r->in_len = readRaw(r, r->in, IN_BYTES);
+            r->in_pos = 0;
+            r->in_eof = r->in_len == 0;
+        }
+        if (r->in_pos == r->in_len && r->in_eof) {
+            if (!r->frame_done) {
+                fprintf(stderr, "Compressed trace is truncated\n");
+                r->error = 1;
+            }
+            return 0;
+        }
+
+        if (r->codec == CODEC_GZIP) {
+            r->zs.next_in = r->in + r->in_pos;
+            r->zs.avail_in = r->in_len - r->in_pos;
+            r->zs.next_out = (unsigned char*) out;
+            r->zs.avail_out = cap;
+            int ret = inflate(&r->zs, Z_NO_FLUSH);
+            r->in_pos = r->in_len - r->zs.avail_in;
+            produced = cap - r->zs.avail_out;
+            r->frame_done = 0;
+            if (ret == Z_STREAM_END) {
+                // gzip files may hold several concatenated members
+                r->frame_done = 1;
+                inflateReset(&r->zs);
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                fprintf(stderr, "gzip trace is corrupt: %s\n",
+                        r->zs.msg ? r->zs.msg : "inflate failed");
+                r->error = 1;
+                return 0;
+            }
+        }
+#ifdef HAVE_ZSTD
+        else if (r->codec == CODEC_ZSTD) {
+            ZSTD_inBuffer in = { r->in, r->in_len, r->in_pos };
+            ZSTD_outBuffer o = { out, cap, 0 };
+            size_t ret = ZSTD_decompressStream(r->zds, &o, &in);
+            if (ZSTD_isError(ret)) {
+                fprintf(stderr, "zstd trace is corrupt: %s\n",
+                        ZSTD_getErrorName(ret));
+                r->error = 1;
+                return 0;
+            }
+            r->in_pos = in.pos;
+            produced = o.pos;
+            r->frame_done = ret == 0;
+        }
+#endif
+#ifdef HAVE_LZ4
+        else if (r->codec == CODEC_LZ4) {
+            size_t out_size = cap;
+            size_t in_size = r->in_len - r->in_pos;
+            size_t ret = LZ4F_decompress(r->lz4, out, &out_size,
+                    r->in + r->in_pos, &in_size, NULL);
+            if (LZ4F_isError(ret)) {
+                fprintf(stderr, "lz4 trace is corrupt: %s\n",
+                        LZ4F_getErrorName(ret));
+                r->error = 1;
+                return 0;
+            }
+            r->in_pos += in_size;
+            produced = out_size;
+            r->frame_done = ret == 0;
+        }
+#endif
+    }
+    return produced;
+}
+
+/* readRaw - Read file bytes, replaying the sniffed magic bytes first */
+static size_t readRaw(TraceReader_t* r, void* buf, size_t n) {
+    size_t got = 0;
+    if (!r->piped && r->magic_pos < r->magic_len) {
+        got = r->magic_len - r->magic_pos;
+        if (got > n) {
+            got = n;
+        }
+        memcpy(buf, r->magic + r->magic_pos, got);
+        r->magic_pos += got;
+    }
+    got += fread((char*) buf + got, 1, n - got, r->file);
+    if (got == 0 && ferror(r->file)) {
+        r->error = 1;
+    }
+    return got;
+}
+
+static enum TraceCodec detectCodec(const unsigned char* magic, size_t len) {
+    if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return CODEC_GZIP;
+    }
+    if (len >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+            magic[2] == 0x2f && magic[3] == 0xfd) {
+        return CODEC_ZSTD;
+    }
+    if (len >= 4 && magic[0] == 0x04 && magic[1] == 0x22 &&
+            magic[2] == 0x4d && magic[3] == 0x18) {
+        return CODEC_LZ4;
+    }
+    return CODEC_PLAIN;
+}
+
+#if !defined(HAVE_ZSTD) || !defined(HAVE_LZ4)
+/*
+ * openPipe - Replace the open file with the output of "<tool> -dc path".
+ *     Only used when the codec library was not available at build time.
+ */
+static int openPipe(TraceReader_t* r, const char* tool, const char* path) {
+    // Quote the path for the shell, escaping embedded single quotes
+    size_t len = strlen(tool) + 16;
+    for (const char* p = path; *p; p++) {
+        len += *p == '\'' ? 4 : 1;
+    }
+    char* cmd = malloc(len);
+    if (!cmd) {
+        return 0;
+    }
+    char* c = cmd + sprintf(cmd, "%s -dc -- '", tool);
+    for (const char* p = path; *p; p++) {
+        if (*p == '\'') {
+            c += sprintf(c, "'\\''");
+        } else {
+            *c++ = *p;
+        }
+    }
+    strcpy(c, "'");
+
+    FILE* pipe = popen(cmd, "r");
+    free(cmd);
+    if (!pipe) {
+        return 0;
+    }
+    fclose(r->file);
+    r->file = pipe;
+    r->piped = 1;
+    return 1;
+}
+#endif
+
+static void traceError(const char* path, const char* msg) {
+    fprintf(stderr, "%s: %s\n", path, msg);
+}
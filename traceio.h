@@ -0,0 +1,95 @@
+/*
+ * traceio.h - Trace file input for the cache simulator
+ *
+ * Traces may be stored plain or compressed with gzip, zstd or lz4; the
+ * format is detected from the leading magic bytes, not the file name.
+ * Decompression runs on a background thread that fills a ring of line
+ * chunks, so the simulator overlaps decoding with simulation.
+ *
+ * The decoded trace is either valgrind lackey text (" L 10,4") or the
+ * binary format below, recognised by its TRACE_BIN_MAGIC header.
+ */
+
+#ifndef TRACEIO_H
+#define TRACEIO_H
+
+/*
+ * Binary traces start with the 8 byte magic string and continue with
+ * little-endian 64-bit records packed as:
+ *   bits  0-47  address
+ *   bits 48-55  access size in bytes
+ *   bits 56-59  operation (TRACE_OP_*)
+ *   bits 60-63  issuing thread, for multi-threaded traces
+ */
+#define TRACE_BIN_MAGIC "CSIMBIN1"
+#define TRACE_BIN_MAGIC_LEN 8
+
+#define TRACE_OP_INSTR 0
+#define TRACE_OP_LOAD 1
+#define TRACE_OP_STORE 2
+#define TRACE_OP_MODIFY 3
+
+#define TRACE_ADDR_MASK ((1ULL << 48) - 1)
+#define TRACE_PACK(op, size, cpu, addr) \
+    (((unsigned long long) (cpu) << 60) | \
+     ((unsigned long long) (op) << 56) | \
+     ((unsigned long long) ((size) & 0xff) << 48) | \
+     ((unsigned long long) (addr) & TRACE_ADDR_MASK))
+
+/* Compression formats recognised by traceOpen */
+enum TraceCodec {
+    CODEC_PLAIN,
+    CODEC_GZIP,
+    CODEC_ZSTD,
+    CODEC_LZ4
+};
+
+typedef struct TraceReader TraceReader_t;
+
+/* One data access read from a trace */
+struct TraceRecord {
+    char op;                /* 'L', 'S' or 'M' */
+    unsigned char size;     /* bytes accessed */
+    unsigned short cpu;     /* issuing thread, 0 for untagged traces */
+    unsigned long address;
+    const char* text;       /* text traces: the line without its leading
+                               space, valid until the next call; NULL for
+                               binary traces */
+};
+typedef struct TraceRecord TraceRecord_t;
+
+/*
+ * traceOpen - Open a trace file ("-" for stdin) and start its decoder
+ *     thread. Returns NULL and prints a message on failure.
+ */
+TraceReader_t* traceOpen(const char* path);
+
+/*
+ * traceNextLine - Return the next line of a text trace with its newline
+ *     stripped, or NULL at end of input. The line stays valid until the
+ *     next call.
+ */
+char* traceNextLine(TraceReader_t* reader);
+
+/*
+ * traceNext - Read the next data access of a text or binary trace into
+ *     rec, skipping instruction fetches. Returns 0 at end of input.
+ */
+int traceNext(TraceReader_t* reader, TraceRecord_t* rec);
+
+/*
+ * traceClose - Stop the decoder thread and release the reader. Returns
+ *     nonzero if the input could not be fully decoded.
+ */
+int traceClose(TraceReader_t* reader);
+
+/* traceCodecName - Name of the codec detected for this reader */
+const char* traceCodecName(TraceReader_t* reader);
+
+/*
+ * traceIsBinary - Whether the decoded trace is in the binary format.
+ *     Only meaningful once the first record or line has been read.
+ */
+int traceIsBinary(TraceReader_t* reader);
+
+#endif /* TRACEIO_H */
@@ -0,0 +1,731 @@
+/*
+ * tracesynth.c - Synthetic memory trace generator
+ *
+ * Emits reproducible traces of arbitrary length directly in the formats
+ * csim reads: valgrind lackey text (" L 600000,4") or the packed binary
+ * format described in traceio.h. Each workload model fills blocks of
+ * packed records, which are then written out in the chosen format, so
+ * binary output runs at memory bandwidth rather than printf speed.
+ *
+ * Models:
+ *   stride     strided walk over a footprint
+ *   chase      pointer chasing around a random cycle of nodes
+ *   matmul     C += A * B over square matrices, in a chosen loop order
+ *   transpose  B = A^T, optionally tiled
+ *   zipf       Zipf distributed accesses over a set of blocks
+ *   mix        round-robin interleaving of several strided streams
+ *
+ * With -c, several threads run the model side by side, each from its
+ * own random seed and shifted by -d bytes per thread, and their accesses
+ * are interleaved round-robin into one binary trace tagged by thread.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+#include "traceio.h"
+
+/* Records generated per block */
+#define BLOCK_RECORDS 4096
+/* Maximum number of interleaved streams in the mix model */
+#define MAX_STREAMS 64
+
+typedef unsigned long long u64;
+
+/* Generator state shared by all models */
+struct Gen {
+    /* options */
+    u64 base;           /* address of the first byte touched */
+    u64 footprint;      /* bytes touched by stride/chase/mix */
+    u64 stride;         /* stride, node or block size in bytes */
+    int elem;           /* access size in bytes */
+    double writes;      /* fraction of stride/zipf/mix accesses that store */
+    int rows;           /* matrix rows (N) */
+    int cols;           /* matrix columns (M) */
+    int tile;           /* transpose tile size, 0 for untiled */
+    char order[4];      /* matmul loop order, e.g. "ijk" */
+    u64 items;          /* zipf blocks */
+    double theta;       /* zipf skew */
+    int streams;        /* mix streams */
+    int quantum;        /* mix accesses per stream turn */
+
+    /* running state */
+    u64 rng;
+    u64 pos;
+    u64 count;
+    unsigned int write_threshold;
+    unsigned int* cycle;        /* chase nodes in visiting order */
+    u64 nodes;
+    struct ZipfSlot* zipf;      /* zipf alias table */
+    u64 idx[4];                 /* loop counters of the matrix models */
+    u64 stream_pos[MAX_STREAMS];
+    int phase;
+};
+typedef struct Gen Gen_t;
+
+/*
+ * One alias table slot: a draw landing in the slot yields block `own`
+ * when its low 32 random bits are below `prob`, else block `alias`.
+ * Keeping the three together means one host cache miss per draw.
+ */
+struct ZipfSlot {
+    unsigned int prob;
+    unsigned int own;
+    unsigned int alias;
+};
+
+typedef int (*fill_fn)(Gen_t* g, u64* out, int n);
+
+static int fillStride(Gen_t* g, u64* out, int n);
+static int fillChase(Gen_t* g, u64* out, int n);
+static int fillMatmul(Gen_t* g, u64* out, int n);
+static int fillTranspose(Gen_t* g, u64* out, int n);
+static int fillZipf(Gen_t* g, u64* out, int n);
+static int fillMix(Gen_t* g, u64* out, int n);
+static void setupChase(Gen_t* g);
+static void setupZipf(Gen_t* g);
+static size_t formatText(const u64* recs, int n, char* out);
+static u64 parseSize(const char* text);
+static int fillThreads(Gen_t* threads, int cores, int quantum, u64 distance,
+        fill_fn fill, u64* out, int n);
+static void usage(char* argv[]);
+
+struct Model {
+    const char* name;
+    fill_fn fill;
+};
+
+static const struct Model models[] = {
+    { "stride", fillStride },
+    { "chase", fillChase },
+    { "matmul", fillMatmul },
+    { "transpose", fillTranspose },
+    { "zipf", fillZipf },
+    { "mix", fillMix },
+};
+#define MODEL_COUNT (int) (sizeof(models) / sizeof(models[0]))
+
+/* xorshift64* - small, fast and good enough for workload synthesis */
+static inline u64 rngNext(Gen_t* g)
+{
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return g->rng * 2685821657736338717ULL;
+}
+
+/* Value in [0, bound), only used while setting up models */
+static u64 rngBelow(Gen_t* g, u64 bound)
+{
+    return rngNext(g) % bound;
+}
+
+/* Load or store, by the configured write fraction */
+static inline int rngOp(Gen_t* g)
+{
+    if (g->write_threshold == 0) {
+        return TRACE_OP_LOAD;
+    }
+    return (unsigned int) rngNext(g) < g->write_threshold ?
+        TRACE_OP_STORE : TRACE_OP_LOAD;
+}
+
+int main(int argc, char* argv[])
+{
+    Gen_t g;
+    memset(&g, 0, sizeof(g));
+    g.base = 0x600000;
+    g.footprint = 64 << 20;
+    g.stride = 64;
+    g.elem = 4;
+    g.rows = 256;
+    g.cols = 0;
+    g.items = 1 << 20;
+    g.theta = 0.99;
+    g.streams = 4;
+    g.quantum = 1;
+    strcpy(g.order, "ijk");
+
+    const struct Model* model = NULL;
+    u64 accesses = 1000000;
+    u64 seed = 341;
+    int binary = 0;
+    char* output = NULL;
+    int cores = 1;
+    int thread_quantum = 1;
+    u64 distance = 0;
+
+    int c;
+    while ((c = getopt(argc, argv, "hm:n:o:Br:a:F:S:e:w:N:M:T:l:K:z:k:q:c:d:Q:")) != -1) {
+        switch (c) {
+        case 'm':
+            for (int i = 0; i < MODEL_COUNT; i++) {
+                if (strcmp(optarg, models[i].name) == 0) {
+                    model = &models[i];
+                }
+            }
+            if (model == NULL) {
+                fprintf(stderr, "Unknown model %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'n':
+            accesses = parseSize(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'B':
+            binary = 1;
+            break;
+        case 'r':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'a':
+            g.base = strtoull(optarg, NULL, 0);
+            break;
+        case 'F':
+            g.footprint = parseSize(optarg);
+            break;
+        case 'S':
+            g.stride = parseSize(optarg);
+            break;
+        case 'e':
+            g.elem = atoi(optarg);
+            break;
+        case 'w':
+            g.writes = atof(optarg);
+            break;
+        case 'N':
+            g.rows = atoi(optarg);
+            break;
+        case 'M':
+            g.cols = atoi(optarg);
+            break;
+        case 'T':
+            g.tile = atoi(optarg);
+            break;
+        case 'l':
+            snprintf(g.order, sizeof(g.order), "%s", optarg);
+            break;
+        case 'K':
+            g.items = parseSize(optarg);
+            break;
+        case 'z':
+            g.theta = atof(optarg);
+            break;
+        case 'k':
+            g.streams = atoi(optarg);
+            break;
+        case 'q':
+            g.quantum = atoi(optarg);
+            break;
+        case 'c':
+            cores = atoi(optarg);
+            break;
+        case 'd':
+            distance = parseSize(optarg);
+            break;
+        case 'Q':
+            thread_quantum = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    if (model == NULL) {
+        fprintf(stderr, "Error: Missing required argument -m <model>\n");
+        usage(argv);
+        exit(1);
+    }
+    if (g.cols == 0) {
+        g.cols = g.rows;
+    }
+    if (g.stride == 0 || g.footprint < g.stride || g.elem < 1 ||
+            g.elem > 255 || g.rows < 1 || g.cols < 1 || g.items < 1 ||
+            g.tile < 0 || g.quantum < 1 ||
+            g.streams < 1 || g.streams > MAX_STREAMS) {
+        fprintf(stderr, "Error: Invalid model parameters\n");
+        exit(1);
+    }
+    if (cores < 1 || cores > 16 || thread_quantum < 1) {
+        fprintf(stderr, "Error: -c must be 1 to 16 and -Q at least 1\n");
+        exit(1);
+    }
+    if (cores > 1 && !binary) {
+        fprintf(stderr, "Error: Multi-threaded traces need the binary format (-B)\n");
+        exit(1);
+    }
+    if (strlen(g.order) != 3 || !strchr(g.order, 'i') ||
+            !strchr(g.order, 'j') || !strchr(g.order, 'k')) {
+        fprintf(stderr, "Error: Loop order must be a permutation of ijk\n");
+        exit(1);
+    }
+    g.rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+    g.write_threshold = g.writes >= 1.0 ? 0xffffffffu :
+        (unsigned int) (g.writes * 4294967296.0);
+    if (model->fill == fillChase) {
+        setupChase(&g);
+    } else if (model->fill == fillZipf) {
+        setupZipf(&g);
+    }
+
+    FILE* out = stdout;
+    if (output) {
+        out = fopen(output, "wb");
+        if (!out) {
+            perror(output);
+            exit(1);
+        }
+    }
+
+    // One generator per thread; they share the read-only model tables
+    Gen_t* threads = malloc(cores * sizeof(Gen_t));
+    for (int c = 0; c < cores; c++) {
+        threads[c] = g;
+        threads[c].rng = (seed + c) * 0x9E3779B97F4A7C15ULL + 1;
+    }
+
+    u64* recs = malloc(BLOCK_RECORDS * sizeof(u64));
+    char* text = malloc(BLOCK_RECORDS * 40);
+    if (binary) {
+        fwrite(TRACE_BIN_MAGIC, 1, TRACE_BIN_MAGIC_LEN, out);
+    }
+    while (g.count < accesses) {
+        int n = BLOCK_RECORDS;
+        if (accesses - g.count < (u64) n) {
+            n = accesses - g.count;
+        }
+        if (cores == 1) {
+            n = model->fill(&threads[0], recs, n);
+        } else {
+            n = fillThreads(threads, cores, thread_quantum, distance,
+                    model->fill, recs, n);
+        }
+        g.count += n;
+        if (binary) {
+            fwrite(recs, sizeof(u64), n, out);
+        } else {
+            fwrite(text, 1, formatText(recs, n, text), out);
+        }
+    }
+    if (fflush(out) != 0 || ferror(out)) {
+        perror("tracesynth: write failed");
+        exit(1);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(text);
+    free(recs);
+    free(threads);
+    return 0;
+}
+
+/*
+ * fillThreads - Interleave the threads' accesses round-robin, quantum
+ *     at a time, shifting thread t by t * distance bytes and tagging its
+ *     records with t. The turn carries over between calls.
+ */
+static int fillThreads(Gen_t* threads, int cores, int quantum, u64 distance,
+        fill_fn fill, u64* out, int n)
+{
+    static int turn = 0;
+    static int used = 0;
+    int produced = 0;
+    while (produced < n) {
+        int take = quantum - used;
+        if (take > n - produced) {
+            take = n - produced;
+        }
+        take = fill(&threads[turn], out + produced, take);
+        for (int i = produced; i < produced + take; i++) {
+            u64 addr = (out[i] & TRACE_ADDR_MASK) + turn * distance;
+            int op = (out[i] >> 56) & 0xf;
+            int size = (out[i] >> 48) & 0xff;
+            out[i] = TRACE_PACK(op, size, turn, addr);
+        }
+        produced += take;
+        used += take;
+        if (used == quantum) {
+            used = 0;
+            turn = (turn + 1) % cores;
+        }
+    }
+    return produced;
+}
+
+/*
+ * fillStride - Walk the footprint with a fixed stride, wrapping around
+ */
+static int fillStride(Gen_t* g, u64* out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        out[i] = TRACE_PACK(rngOp(g), g->elem, 0, g->base + g->pos);
+        g->pos += g->stride;
+        if (g->pos >= g->footprint) {
+            g->pos -= g->footprint;
+        }
+    }
+    return n;
+}
+
+/*
+ * fillChase - Follow a random single-cycle permutation, loading the
+ *     next pointer of each node in turn. The cycle is stored in visiting
+ *     order, so emitting it does not itself chase pointers.
+ */
+static int fillChase(Gen_t* g, u64* out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        out[i] = TRACE_PACK(TRACE_OP_LOAD, 8, 0,
+                g->base + g->cycle[g->pos] * g->stride);
+        if (++g->pos == g->nodes) {
+            g->pos = 0;
+        }
+    }
+    return n;
+}
+
+/*
+ * fillMatmul - C[i][j] += A[i][k] * B[k][j] over N x N matrices laid out
+ *     one after another, visiting (i, j, k) in the configured loop order.
+ *     Each step loads A and B and modifies C.
+ */
+static int fillMatmul(Gen_t* g, u64* out, int n)
+{
+    u64 dim = g->rows;
+    u64 a = g->base;
+    u64 b = a + dim * dim * g->elem;
+    u64 c = b + dim * dim * g->elem;
+    int produced = 0;
+    while (produced < n) {
+        // idx[0] is the outer loop, idx[2] the inner one
+        u64 v[3];
+        for (int l = 0; l < 3; l++) {
+            v[g->order[l] - 'i'] = g->idx[l];
+        }
+        u64 i = v[0], j = v[1], k = v[2];
+        u64 addr;
+        int op = TRACE_OP_LOAD;
+        if (g->phase == 0) {
+            addr = a + (i * dim + k) * g->elem;
+        } else if (g->phase == 1) {
+            addr = b + (k * dim + j) * g->elem;
+        } else {
+            addr = c + (i * dim + j) * g->elem;
+            op = TRACE_OP_MODIFY;
+        }
+        out[produced++] = TRACE_PACK(op, g->elem, 0, addr);
+        if (++g->phase < 3) {
+            continue;
+        }
+        g->phase = 0;
+        for (int l = 2; l >= 0; l--) {
+            if (++g->idx[l] < dim) {
+                break;
+            }
+            g->idx[l] = 0;
+        }
+    }
+    return produced;
+}
+
+/*
+ * fillTranspose - B = A^T for an N x M matrix A, reading A row-wise and
+ *     storing B column-wise, in tiles of -T when tiling is enabled
+ */
+static int fillTranspose(Gen_t* g, u64* out, int n)
+{
+    u64 rows = g->rows, cols = g->cols;
+    u64 tile = g->tile ? g->tile : (rows > cols ? rows : cols);
+    u64 a = g->base;
+    u64 b = a + rows * cols * g->elem;
+    int produced = 0;
+    while (produced < n) {
+        // idx: tile row, tile column, row within tile, column within tile
+        u64 i = g->idx[0] + g->idx[2];
+        u64 j = g->idx[1] + g->idx[3];
+        if (g->phase == 0) {
+            out[produced++] = TRACE_PACK(TRACE_OP_LOAD, g->elem, 0,
+                    a + (i * cols + j) * g->elem);
+            g->phase = 1;
+            continue;
+        }
+        out[produced++] = TRACE_PACK(TRACE_OP_STORE, g->elem, 0,
+                b + (j * rows + i) * g->elem);
+        g->phase = 0;
+
+        if (++g->idx[3] < tile && g->idx[1] + g->idx[3] < cols) {
+            continue;
+        }
+        g->idx[3] = 0;
+        if (++g->idx[2] < tile && g->idx[0] + g->idx[2] < rows) {
+            continue;
+        }
+        g->idx[2] = 0;
+        g->idx[1] += tile;
+        if (g->idx[1] < cols) {
+            continue;
+        }
+        g->idx[1] = 0;
+        g->idx[0] += tile;
+        if (g->idx[0] >= rows) {
+            g->idx[0] = 0;
+        }
+    }
+    return produced;
+}
+
+/*
+ * fillZipf - Draw block ranks from the Zipf alias table. The random
+ *     draws of a block are made first, so each table slot can be
+ *     prefetched ZIPF_PREFETCH draws before it is needed and the lookups
+ *     into a large hot set overlap.
+ */
+#define ZIPF_PREFETCH 16
+static int fillZipf(Gen_t* g, u64* out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        out[i] = rngNext(g);
+    }
+    for (int i = 0; i < n; i++) {
+        if (i + ZIPF_PREFETCH < n) {
+            u64 ahead = out[i + ZIPF_PREFETCH];
+            __builtin_prefetch(&g->zipf[((ahead >> 32) * g->items) >> 32]);
+        }
+        u64 r = out[i];
+        struct ZipfSlot* slot = &g->zipf[((r >> 32) * g->items) >> 32];
+        // select without a branch; the comparison is unpredictable
+        u64 use_own = (unsigned int) r < slot->prob;
+        u64 block = slot->alias ^ ((slot->own ^ slot->alias) & -use_own);
+        out[i] = TRACE_PACK(rngOp(g), g->elem, 0, g->base + block * g->stride);
+    }
+    return n;
+}
+
+/*
+ * fillMix - Interleave -k strided streams round-robin, -q accesses per
+ *     turn. Stream s walks its own footprint-sized region.
+ */
+static int fillMix(Gen_t* g, u64* out, int n)
+{
+    for (int i = 0; i < n; i++) {
+        int s = g->phase;
+        u64 addr = g->base + s * g->footprint + g->stream_pos[s];
+        out[i] = TRACE_PACK(rngOp(g), g->elem, 0, addr);
+        g->stream_pos[s] += g->stride;
+        if (g->stream_pos[s] >= g->footprint) {
+            g->stream_pos[s] -= g->footprint;
+        }
+        // compare and reset rather than divide, as the default quantum
+        // of 1 changes stream on every access
+        if (++g->pos == (u64) g->quantum) {
+            g->pos = 0;
+            if (++g->phase == g->streams) {
+                g->phase = 0;
+            }
+        }
+    }
+    return n;
+}
+
+/*
+ * setupChase - Shuffle footprint/stride nodes into the random cycle the
+ *     chase visits; successive entries are each other's next pointers
+ */
+static void setupChase(Gen_t* g)
+{
+    g->nodes = g->footprint / g->stride;
+    if (g->nodes > 0xffffffffULL) {
+        fprintf(stderr, "Error: Too many chase nodes\n");
+        exit(1);
+    }
+    g->cycle = malloc(g->nodes * sizeof(unsigned int));
+    if (!g->cycle) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    for (u64 i = 0; i < g->nodes; i++) {
+        g->cycle[i] = i;
+    }
+    for (u64 i = g->nodes - 1; i > 0; i--) {
+        u64 j = rngBelow(g, i + 1);
+        unsigned int tmp = g->cycle[i];
+        g->cycle[i] = g->cycle[j];
+        g->cycle[j] = tmp;
+    }
+}
+
+/*
+ * setupZipf - Build a Vose alias table for P(rank) ~ 1 / (rank+1)^theta,
+ *     mapping ranks to blocks through a random permutation
+ */
+static void setupZipf(Gen_t* g)
+{
+    u64 k = g->items;
+    if (k > 0xffffffffULL) {
+        fprintf(stderr, "Error: Too many zipf blocks\n");
+        exit(1);
+    }
+    double* p = malloc(k * sizeof(double));
+    unsigned int* small = malloc(k * sizeof(unsigned int));
+    unsigned int* large = malloc(k * sizeof(unsigned int));
+    unsigned int* perm = malloc(k * sizeof(unsigned int));
+    g->zipf = malloc(k * sizeof(struct ZipfSlot));
+    if (!p || !small || !large || !perm || !g->zipf) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    for (u64 i = 0; i < k; i++) {
+        perm[i] = i;
+    }
+    for (u64 i = k - 1; i > 0; i--) {
+        u64 j = rngBelow(g, i + 1);
+        unsigned int tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+    }
+
+    double total = 0;
+    for (u64 i = 0; i < k; i++) {
+        p[i] = pow(i + 1.0, -g->theta);
+        total += p[i];
+    }
+    u64 ns = 0, nl = 0;
+    for (u64 i = 0; i < k; i++) {
+        p[i] = p[i] * k / total;
+        g->zipf[i].own = perm[i];
+        if (p[i] < 1.0) {
+            small[ns++] = i;
+        } else {
+            large[nl++] = i;
+        }
+    }
+    while (ns > 0 && nl > 0) {
+        unsigned int s = small[--ns];
+        unsigned int l = large[--nl];
+        g->zipf[s].prob = (unsigned int) (p[s] * 4294967295.0);
+        g->zipf[s].alias = perm[l];
+        p[l] -= 1.0 - p[s];
+        if (p[l] < 1.0) {
+            small[ns++] = l;
+        } else {
+            large[nl++] = l;
+        }
+    }
+    // leftovers are 1.0 up to rounding
+    while (nl > 0) {
+        unsigned int l = large[--nl];
+        g->zipf[l].prob = 0xffffffffu;
+        g->zipf[l].alias = perm[l];
+    }
+    while (ns > 0) {
+        unsigned int s = small[--ns];
+        g->zipf[s].prob = 0xffffffffu;
+        g->zipf[s].alias = perm[s];
+    }
+    free(p);
+    free(small);
+    free(large);
+    free(perm);
+}
+
+/*
+ * formatText - Write records as lackey lines (" L 600000,4"); returns
+ *     the number of bytes written to out
+ */
+static size_t formatText(const u64* recs, int n, char* out)
+{
+    static const char ops[] = "ILSM";
+    static const char hex[] = "0123456789abcdef";
+    char* p = out;
+    for (int i = 0; i < n; i++) {
+        u64 addr = recs[i] & TRACE_ADDR_MASK;
+        int size = (recs[i] >> 48) & 0xff;
+        *p++ = ' ';
+        *p++ = ops[(recs[i] >> 56) & 3];
+        *p++ = ' ';
+        int digits = 1;
+        while (digits < 12 && (addr >> (4 * digits))) {
+            digits++;
+        }
+        for (int d = digits - 1; d >= 0; d--) {
+            *p++ = hex[(addr >> (4 * d)) & 0xf];
+        }
+        *p++ = ',';
+        if (size >= 100) {
+            *p++ = '0' + size / 100;
+        }
+        if (size >= 10) {
+            *p++ = '0' + size / 10 % 10;
+        }
+        *p++ = '0' + size % 10;
+        *p++ = '\n';
+    }
+    return p - out;
+}
+
+/* parseSize - Parse a count or byte size with an optional k/M/G suffix */
+static u64 parseSize(const char* text)
+{
+    char* end;
+    u64 value = strtoull(text, &end, 0);
+    switch (*end) {
+    case 'k':
+    case 'K':
+        return value << 10;
+    case 'm':
+    case 'M':
+        return value << 20;
+    case 'g':
+    case 'G':
+        return value << 30;
+    default:
+        return value;
+    }
+}
+
+/*
+ * usage - Print usage info
+ */
+static void usage(char* argv[])
+{
+    printf("Usage: %s [-h] -m <model> [-n <accesses>] [-o <file>] [-B] [-r <seed>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h            Print this help message.\n");
+    printf("  -m <model>    stride, chase, matmul, transpose, zipf or mix\n");
+    printf("  -n <count>    Number of accesses to emit (default 1000000)\n");
+    printf("  -o <file>     Output file (default stdout)\n");
+    printf("  -B            Emit the binary trace format instead of text\n");
+    printf("  -r <seed>     Random seed (default 341)\n");
+    printf("Model parameters (sizes accept k/M/G suffixes):\n");
+    printf("  -a <addr>     Base address (default 0x600000)\n");
+    printf("  -F <bytes>    Footprint of stride/chase/mix streams (default 64M)\n");
+    printf("  -S <bytes>    Stride, chase node size or zipf block size (default 64)\n");
+    printf("  -e <bytes>    Access size / matrix element size (default 4)\n");
+    printf("  -w <frac>     Fraction of stride/zipf/mix accesses that are stores\n");
+    printf("  -N <rows>     Matrix rows (default 256)\n");
+    printf("  -M <cols>     Transpose matrix columns (default N)\n");
+    printf("  -T <tile>     Transpose tile size (default untiled)\n");
+    printf("  -l <order>    Matmul loop order, a permutation of ijk (default ijk)\n");
+    printf("  -K <blocks>   Zipf block count (default 1M)\n");
+    printf("  -z <theta>    Zipf skew (default 0.99)\n");
+    printf("  -k <streams>  Mix stream count (default 4, max %d)\n", MAX_STREAMS);
+    printf("  -q <count>    Mix accesses per stream turn (default 1)\n");
+    printf("Threads (binary output only):\n");
+    printf("  -c <threads>  Interleave this many threads, tagging each record (max 16)\n");
+    printf("  -d <bytes>    Address shift between threads (default 0: shared data)\n");
+    printf("  -Q <count>    Accesses per thread turn (default 1)\n");
+    printf("Example: %s -m transpose -N 64 -T 8 -n 8192 | ./csim -s 5 -E 1 -b 5 -t -\n", argv[0]);
+}
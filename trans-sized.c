@@ -0,0 +1,138 @@
+/*
+ * trans-sized.c - Matrix transpose B = A^T for elements of 1, 2, 4, 8
+ *     and 16 bytes
+ *
+ * Each element size has a blocked out-of-place transpose and an in-place
+ * one. A sized transpose has a prototype of the form:
+ * void trans(int M, int N, const void* A, void* B);
+ * where A has N rows of M elements and B gets M rows of N. The in-place
+ * transposes are called with B == A.
+ *
+ * Like trans.c this file is compiled without optimization, so that the
+ * traces tracegen records follow the code as written.
+ */
+#include <stdint.h>
+#include "cachelab.h"
+
+/* A 16-byte element, e.g. a pair of 64-bit fields */
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} elem16_t;
+
+/*
+ * DEFINE_BLOCKED - A blocked transpose of tile x tile elements. Each row
+ *     of a tile of A is copied to locals before it is written down the
+ *     column of B, so that when a row of A and the column of B share a
+ *     set (the diagonal blocks transpose_block32 special-cases) the row
+ *     is not evicted half read.
+ */
+#define DEFINE_BLOCKED(name, type, tile)                                \
+void name(int M, int N, const void* A_, void* B_)                       \
+{                                                                       \
+    const type (*A)[M] = A_;                                            \
+    type (*B)[N] = B_;                                                  \
+    type row[tile];                                                     \
+    for (int rowBlock = 0; rowBlock < N; rowBlock += tile) {            \
+        for (int colBlock = 0; colBlock < M; colBlock += tile) {        \
+            int colEnd = colBlock + tile < M ? colBlock + tile : M;     \
+            for (int i = rowBlock; i < N && i < rowBlock + tile; i++) { \
+                for (int j = colBlock; j < colEnd; j++)                 \
+                    row[j - colBlock] = A[i][j];                        \
+                for (int j = colBlock; j < colEnd; j++)                 \
+                    B[j][i] = row[j - colBlock];                        \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+}
+
+/*
+ * DEFINE_IN_PLACE - An in-place transpose. A square matrix swaps the
+ *     two tiles on either side of the diagonal. A rectangular one
+ *     follows the cycles of the permutation: the element at index k of
+ *     the N x M row-major array belongs at k * N mod (M * N - 1). Each
+ *     cycle is rotated once, from its smallest index, which is found by
+ *     walking the cycle until it returns (a leader) or drops below the
+ *     start (visited from an earlier leader). No buffer is allocated.
+ */
+#define DEFINE_IN_PLACE(name, type, tile)                               \
+void name(int M, int N, const void* A_, void* B_)                       \
+{                                                                       \
+    type* a = B_;                                                       \
+    type tmp;                                                           \
+    (void) A_;                                                          \
+    if (M == N) {                                                       \
+        for (int rowBlock = 0; rowBlock < N; rowBlock += tile) {        \
+            for (int colBlock = rowBlock; colBlock < N; colBlock += tile) { \
+                for (int i = rowBlock; i < N && i < rowBlock + tile; i++) { \
+                    int j = colBlock == rowBlock ? i + 1 : colBlock;    \
+                    for (; j < N && j < colBlock + tile; j++) {         \
+                        tmp = a[(long) i * N + j];                      \
+                        a[(long) i * N + j] = a[(long) j * N + i];      \
+                        a[(long) j * N + i] = tmp;                      \
+                    }                                                   \
+                }                                                       \
+            }                                                           \
+        }                                                               \
+        return;                                                         \
+    }                                                                   \
+    long last = (long) M * N - 1;                                       \
+    for (long start = 1; start < last; start++) {                       \
+        long k = start * N % last;                                      \
+        while (k > start)                                               \
+            k = k * N % last;                                           \
+        if (k != start)                                                 \
+            continue;                                                   \
+        tmp = a[start];                                                 \
+        for (k = start * N % last; k != start; k = k * N % last) {      \
+            type displaced = a[k];                                      \
+            a[k] = tmp;                                                 \
+            tmp = displaced;                                            \
+        }                                                               \
+        a[start] = tmp;                                                 \
+    }                                                                   \
+}
+
+/* Tile rows are 16 bytes (two elements of 16 bytes), so the tile's
+   column of a 64-wide B stays inside the 1KB graded cache: a 32-byte
+   row would wrap it and thrash, e.g. 4352 misses instead of 944 for
+   2-byte elements at 64 x 64 */
+DEFINE_BLOCKED(transpose_blocked8, uint8_t, 16)
+DEFINE_BLOCKED(transpose_blocked16, uint16_t, 8)
+DEFINE_BLOCKED(transpose_blocked32, uint32_t, 4)
+DEFINE_BLOCKED(transpose_blocked64, uint64_t, 2)
+DEFINE_BLOCKED(transpose_blocked128, elem16_t, 2)
+
+DEFINE_IN_PLACE(transpose_in_place8, uint8_t, 16)
+DEFINE_IN_PLACE(transpose_in_place16, uint16_t, 8)
+DEFINE_IN_PLACE(transpose_in_place32, uint32_t, 4)
+DEFINE_IN_PLACE(transpose_in_place64, uint64_t, 2)
+DEFINE_IN_PLACE(transpose_in_place128, elem16_t, 2)
+
+/*
+ * registerSizedFunctions - Register the sized transposes with the
+ *     driver, one blocked and one in-place transpose per element size
+ */
+void registerSizedFunctions()
+{
+    registerSizedTransFunction(transpose_blocked8, 1, 0,
+                               "Blocked transpose, 1-byte elements");
+    registerSizedTransFunction(transpose_in_place8, 1, 1,
+                               "In-place transpose, 1-byte elements");
+    registerSizedTransFunction(transpose_blocked16, 2, 0,
+                               "Blocked transpose, 2-byte elements");
+    registerSizedTransFunction(transpose_in_place16, 2, 1,
+                               "In-place transpose, 2-byte elements");
+    registerSizedTransFunction(transpose_blocked32, 4, 0,
+                               "Blocked transpose, 4-byte elements");
+    registerSizedTransFunction(transpose_in_place32, 4, 1,
+                               "In-place transpose, 4-byte elements");
+    registerSizedTransFunction(transpose_blocked64, 8, 0,
+                               "Blocked transpose, 8-byte elements");
+    registerSizedTransFunction(transpose_in_place64, 8, 1,
+                               "In-place transpose, 8-byte elements");
+    registerSizedTransFunction(transpose_blocked128, 16, 0,
+                               "Blocked transpose, 16-byte elements");
+    registerSizedTransFunction(transpose_in_place128, 16, 1,
+                               "In-place transpose, 16-byte elements");
+}
@@ -0,0 +1,189 @@
+/*
+ * victim.c - Victim cache and miss cache for the cache simulator
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "victim.h"
+
+static void unlinkNode(Victim_t* vc, long node);
+static void pushFront(Victim_t* vc, long node);
+static long hashBlock(Victim_t* vc, long block);
+
+Victim_t* victimCreate(const char* spec, const SetIndex_t* index, int E) {
+    char name[16];
+    int entries = 4;
+    int used = 0;
+    int fields = sscanf(spec, "%15[a-z]%n", name, &used);
+    // the whole spec must parse, so victim:x is not taken as victim
+    int more = 0;
+    if (fields == 1 && spec[used] == ':' &&
+            sscanf(spec + used, ":%d%n", &entries, &more) == 1) {
+        used += more;
+    }
+    if (fields < 1 || spec[used] != '\0' || entries < 1 ||
+            entries > MAX_VICTIM_ENTRIES) {
+        return NULL;
+    }
+    Victim_t* vc = calloc(1, sizeof(Victim_t));
+    if (vc == NULL) {
+        return NULL;
+    }
+    if (strcmp(name, "victim") == 0) {
+        vc->kind = VICTIM_CACHE;
+    } else if (strcmp(name, "miss") == 0) {
+        vc->kind = MISS_CACHE;
+    } else {
+        free(vc);
+        return NULL;
+    }
+    vc->entries = entries;
+    vc->index = *index;
+    initializeCache(vc->lines, 1, entries);
+
+    // once the shadow's first array is allocated, sets * E cannot overflow
+    vc->block = allocateArray(index->sets, E, sizeof(long));
+    if (vc->block == NULL) {
+        victimFree(vc);
+        return NULL;
+    }
+    vc->capacity = index->sets * E;
+    long buckets = 1;
+    while (buckets < vc->capacity) {
+        buckets <<= 1;
+    }
+    vc->bucket_mask = buckets - 1;
+    vc->prev = allocateArray(index->sets, E, sizeof(long));
+    vc->next = allocateArray(index->sets, E, sizeof(long));
+    vc->chain = allocateArray(index->sets, E, sizeof(long));
+    vc->buckets = allocateArray(buckets, 1, sizeof(long));
+    if (!vc->prev || !vc->next || !vc->chain || !vc->buckets) {
+        victimFree(vc);
+        return NULL;
+    }
+    for (long i = 0; i < buckets; i++) {
+        vc->buckets[i] = -1;
+    }
+    vc->head = -1;
+    vc->tail = -1;
+    return vc;
+}
+
+void victimFree(Victim_t* vc) {
+    free(vc->block);
+    free(vc->prev);
+    free(vc->next);
+    free(vc->chain);
+    free(vc->buckets);
+    free(vc);
+}
+
+int victimShadow(Victim_t* vc, long set, long tag) {
+    long block = setToBlock(&vc->index, set, tag);
+    long* bucket = &vc->buckets[hashBlock(vc, block)];
+    for (long node = *bucket; node >= 0; node = vc->chain[node]) {
+        if (vc->block[node] == block) {
+            unlinkNode(vc, node);
+            pushFront(vc, node);
+            return 1;
+        }
+    }
+
+    long node;
+    if (vc->count < vc->capacity) {
+        node = vc->count++;
+    } else {
+        // recycle the least recently used node, dropping it from its chain
+        node = vc->tail;
+        unlinkNode(vc, node);
+        long* link = &vc->buckets[hashBlock(vc, vc->block[node])];
+        while (*link != node) {
+            link = &vc->chain[*link];
+        }
+        *link = vc->chain[node];
+    }
+    vc->block[node] = block;
+    vc->chain[node] = *bucket;
+    *bucket = node;
+    pushFront(vc, node);
+    return 0;
+}
+
+int victimMiss(Victim_t* vc, long set, long tag, Line_t* evicted) {
+    long block = setToBlock(&vc->index, set, tag);
+    vc->clock++;
+    int line = findLine(vc->lines, vc->entries, block);
+    if (line >= 0) {
+        vc->absorbed++;
+        if (vc->kind == VICTIM_CACHE) {
+            // swap: the displaced main cache line takes the slot
+            vc->lines[line].valid = 0;
+            if (evicted->valid) {
+                vc->lines[line].valid = 1;
+                vc->lines[line].tag = setToBlock(&vc->index, set, evicted->tag);
+                vc->lines[line].last_used = vc->clock;
+            }
+        } else {
+            vc->lines[line].last_used = vc->clock;
+        }
+        return 1;
+    }
+
+    // a victim cache keeps what the main cache drops, a miss cache
+    // keeps what it fetches
+    long keep = block;
+    if (vc->kind == VICTIM_CACHE) {
+        if (!evicted->valid) {
+            return 0;
+        }
+        keep = setToBlock(&vc->index, set, evicted->tag);
+    }
+    line = victimLine(vc->lines, vc->entries);
+    vc->lines[line].valid = 1;
+    vc->lines[line].tag = keep;
+    vc->lines[line].last_used = vc->clock;
+    return 0;
+}
+
+void victimPrintSummary(Victim_t* vc) {
+    printf("%s cache entries:%d absorbed:%ld conflict_misses:%ld "
+            "absorbed_conflicts:%ld\n",
+            vc->kind == VICTIM_CACHE ? "victim" : "miss", vc->entries,
+            vc->absorbed, vc->conflicts, vc->absorbed_conflicts);
+}
+
+void victimPrintJson(Victim_t* vc, FILE* out) {
+    fprintf(out, "\"%s_cache\":{\"entries\":%d,\"absorbed\":%ld,"
+            "\"conflict_misses\":%ld,\"absorbed_conflicts\":%ld}",
+            vc->kind == VICTIM_CACHE ? "victim" : "miss", vc->entries,
+            vc->absorbed, vc->conflicts, vc->absorbed_conflicts);
+}
+
+static void unlinkNode(Victim_t* vc, long node) {
+    if (vc->prev[node] >= 0) {
+        vc->next[vc->prev[node]] = vc->next[node];
+    } else {
+        vc->head = vc->next[node];
+    }
+    if (vc->next[node] >= 0) {
+        vc->prev[vc->next[node]] = vc->prev[node];
+    } else {
+        vc->tail = vc->prev[node];
+    }
+}
+
+static void pushFront(Victim_t* vc, long node) {
+    vc->prev[node] = -1;
+    vc->next[node] = vc->head;
+    if (vc->head >= 0) {
+        vc->prev[vc->head] = node;
+    } else {
+        vc->tail = node;
+    }
+    vc->head = node;
+}
+
+static long hashBlock(Victim_t* vc, long block) {
+    return (long)(((unsigned long)block * 0x9E3779B97F4A7C15UL) >> 32) &
+            vc->bucket_mask;
+}
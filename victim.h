@@ -0,0 +1,87 @@
+/*
+ * victim.h - Victim cache and miss cache for the cache simulator
+ *
+ * Both are small fully associative LRU buffers probed on a miss in the
+ * main cache (Jouppi, ISCA 1990):
+ *   victim  holds the lines the main cache evicts; a hit swaps the line
+ *           back into the main cache in exchange for the line it
+ *           displaces there
+ *   miss    holds a copy of every block the main cache misses on; a hit
+ *           refills the main cache from it
+ *
+ * A miss served by either is counted as a hit of the main cache. To say
+ * how many conflict misses they absorb, every demand access also feeds a
+ * fully associative LRU cache of the main cache's capacity: a main cache
+ * miss that hits there is a conflict miss.
+ */
+
+#ifndef VICTIM_H
+#define VICTIM_H
+
+#include <stdio.h>
+#include "cache.h"
+
+enum VictimKind {
+    VICTIM_CACHE,
+    MISS_CACHE
+};
+
+/* Largest victim or miss cache */
+#define MAX_VICTIM_ENTRIES 64
+
+struct Victim {
+    enum VictimKind kind;
+    int entries;
+    SetIndex_t index;
+    Line_t lines[MAX_VICTIM_ENTRIES];   /* tag holds the block number */
+    long clock;
+
+    /* fully associative shadow of the main cache: an LRU list of
+       capacity nodes, found through a chained hash of block numbers */
+    long capacity;
+    long count;
+    long* block;
+    long* prev;
+    long* next;
+    long* chain;
+    long* buckets;
+    long bucket_mask;
+    long head;
+    long tail;
+
+    long absorbed;          /* main cache misses served by the buffer */
+    long conflicts;         /* main cache misses the shadow would hit */
+    long absorbed_conflicts; /* conflict misses served by the buffer */
+};
+typedef struct Victim Victim_t;
+
+/*
+ * victimCreate - Parse a spec of the form "victim[:entries]" or
+ *     "miss[:entries]" (default 4 entries) for a main cache with E
+ *     lines per set, indexed by index.
+ *     Returns NULL for an invalid spec or when out of memory.
+ */
+Victim_t* victimCreate(const char* spec, const SetIndex_t* index, int E);
+void victimFree(Victim_t* vc);
+
+/*
+ * victimShadow - Feed a demand access to the fully associative shadow.
+ *     Returns whether the shadow hit, i.e. whether a main cache miss on
+ *     this access is a conflict miss.
+ */
+int victimShadow(Victim_t* vc, long set, long tag);
+
+/*
+ * victimMiss - Probe the buffer on a main cache miss. evicted is the
+ *     line the main cache replaces to make room. Returns 1 when the
+ *     buffer supplies the block.
+ */
+int victimMiss(Victim_t* vc, long set, long tag, Line_t* evicted);
+
+/* Print the buffer's counts */
+void victimPrintSummary(Victim_t* vc);
+
+/* Write the same counts as a "victim_cache" or "miss_cache" JSON member */
+void victimPrintJson(Victim_t* vc, FILE* out);
+
+#endif /* VICTIM_H */